@@ -0,0 +1,152 @@
+#include "Arena.h"
+#include "BenchHarness.h"
+#include "FriendGraph.h"
+#include "Post.h"
+#include "PostStore.h"
+#include "Timeline.h"
+#include "User.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Measurement {
+    size_t allocations;
+    double seconds;
+};
+
+template <typename F>
+Measurement measure(F&& body) {
+    allocationCount = 0;
+    countingAllocations = true;
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto stop = std::chrono::steady_clock::now();
+    countingAllocations = false;
+    return {allocationCount.load(), std::chrono::duration<double>(stop - start).count()};
+}
+
+// Deterministic social graph: every user befriends 'degree' others both ways and writes
+// 'postsPerUser' posts, alternating public and friends-only.
+struct BenchData {
+    StringPool strings;
+    Arena<User> userArena;
+    FriendGraph graph;
+    PostStore posts{graph};
+    std::vector<User*> users;
+
+    BenchData(uint32_t userCount, uint32_t degree, uint32_t postsPerUser) {
+        auto epoch = std::chrono::system_clock::time_point(std::chrono::seconds(1762600000));
+        for (uint32_t i = 0; i < userCount; ++i) {
+            std::string id = "u" + std::to_string(i + 1);
+            users.push_back(userArena.create(strings, "User" + std::to_string(i + 1), id,
+                                             "user" + std::to_string(i + 1) + "@fakebook.com", Credential::parse("Pass"), 20, 'F', "Country",
+                                             true, epoch));
+            graph.addNode(users.back());
+        }
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        uint64_t state = 88172645463325252ULL;
+        for (uint32_t i = 0; i < userCount; ++i) {
+            for (uint32_t k = 0; k < degree / 2; ++k) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                uint32_t other = static_cast<uint32_t>(state % userCount);
+                if (other == i)
+                    continue;
+                edges.emplace_back(i, other);
+                edges.emplace_back(other, i);
+            }
+        }
+        graph.assignEdges(edges);
+
+        uint64_t postNumber = 0;
+        for (uint32_t i = 0; i < userCount; ++i) {
+            for (uint32_t k = 0; k < postsPerUser; ++k, ++postNumber) {
+                auto timestamp = epoch + std::chrono::seconds((postNumber * 7919) % 10000000);
+                uint32_t row = posts.append(users[i], "p" + std::to_string(postNumber),
+                                            "This is post content no." + std::to_string(postNumber), timestamp, k % 2 == 0);
+                users[i]->addLoadedPost(row);
+            }
+        }
+        for (User* user : users)
+            user->sortPostsByTime(posts);
+    }
+};
+
+void report(const std::string& name, const Measurement& result, size_t items, size_t allowedAllocations) {
+    std::ostringstream detail;
+    detail << items << " items, " << result.allocations << " allocations (allowed " << allowedAllocations << "), "
+           << result.seconds * 1e9 / static_cast<double>(items == 0 ? 1 : items) << " ns/item";
+    check(name, result.allocations <= allowedAllocations, detail.str());
+}
+
+/* Proves the feed and save paths allocate per call, never per post, friend or author:
+     - a warm feed page allocates only the page itself, whatever its size;
+     - a deep page that bypasses the feed buffers allocates the same;
+     - writing Friends.txt and Posts.txt lines allocates nothing;
+     - the PostStore timestamp/visibility filter allocates nothing. */
+int main() {
+    BenchData data(20000, 20, 10);
+    TimelineService timelines(data.posts, 200, 1000);
+    User* viewer = data.users[7];
+
+    // first reads build and cache the feed buffers and size the scratch vectors
+    timelines.queryFeed(viewer, 200, FeedCursor());
+    FeedPage deepStart = timelines.queryFeed(viewer, 400, FeedCursor());
+    timelines.queryFeed(viewer, 200, deepStart.next);
+
+    for (size_t limit : {20, 200}) {
+        FeedPage page;
+        Measurement result = measure([&]() { page = timelines.queryFeed(viewer, limit, FeedCursor()); });
+        report("feed page, limit " + std::to_string(limit), result, page.posts.size(), 1);
+    }
+    {
+        FeedPage page;
+        Measurement result = measure([&]() { page = timelines.queryFeed(viewer, 200, deepStart.next); });
+        report("deep feed page (author merge)", result, page.posts.size(), 1);
+    }
+
+    NullBuffer sink;
+    std::ostream out(&sink);
+    {
+        size_t friendLinks = 0;
+        for (User* user : data.users)
+            friendLinks += user->friendCount();
+        Measurement result = measure([&]() {
+            for (User* user : data.users) {
+                user->writeFriendLine(out);
+                out << '\n';
+            }
+        });
+        report("save Friends.txt", result, friendLinks, 0);
+    }
+    {
+        Measurement result = measure([&]() {
+            for (uint32_t row = 0; row < data.posts.size(); ++row) {
+                data.posts.at(row).writeLine(out);
+                out << '\n';
+            }
+        });
+        report("save Posts.txt", result, data.posts.size(), 0);
+    }
+    {
+        // every user's public posts up to the middle of the time range, through the filter kernel
+        std::vector<uint32_t> kept(data.posts.size());
+        PostStore::Ticks until = data.posts.ticks(static_cast<uint32_t>(data.posts.size() / 2));
+        size_t keptCount = 0;
+        Measurement result = measure([&]() {
+            for (User* user : data.users) {
+                const std::vector<uint32_t>& rows = user->postsByTime();
+                keptCount += data.posts.filter(rows.data(), rows.size(), until, true, kept.data() + keptCount);
+            }
+        });
+        report("filter posts by time and visibility", result, data.posts.size(), 0);
+    }
+    return failedChecks() == 0 ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+#include "BenchHarness.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <thread>
+
+std::atomic<size_t> allocationCount{0};
+std::atomic<bool> countingAllocations{false};
+
+// Replacing the global operators is the only way to see allocations made inside the standard library.
+void* operator new(std::size_t size) {
+    if (countingAllocations.load(std::memory_order_relaxed))
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size))
+        return memory;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+
+int failures = 0;
+
+void check(const std::string& name, bool ok, const std::string& detail) {
+    if (!ok)
+        ++failures;
+    std::cout << (ok ? "[ok]   " : "[FAIL] ") << name << (detail.empty() ? "" : ": " + detail) << std::endl;
+}
+
+int failedChecks() {
+    return failures;
+}
+
+double percentileOf(const std::vector<double>& sorted, double fraction) {
+    if (sorted.empty())
+        return 0;
+    return sorted[static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1))];
+}
+
+const BenchResult& BenchSuite::run(const std::string& name, size_t scale, size_t samples, size_t opsPerSample,
+                                   const std::function<void(size_t sample)>& body,
+                                   const std::function<void(size_t sample)>& setup) {
+    std::vector<double> latencies;
+    latencies.reserve(samples);
+    size_t allocations = 0;
+    double seconds = 0;
+    for (size_t sample = 0; sample < samples; ++sample) {
+        if (setup)
+            setup(sample);
+        allocationCount = 0;
+        countingAllocations = true;
+        auto start = std::chrono::steady_clock::now();
+        body(sample);
+        auto stop = std::chrono::steady_clock::now();
+        countingAllocations = false;
+        allocations += allocationCount.load();
+        double elapsed = std::chrono::duration<double>(stop - start).count();
+        seconds += elapsed;
+        latencies.push_back(elapsed * 1e9 / static_cast<double>(opsPerSample));
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    BenchResult result;
+    result.name = name;
+    result.scale = scale;
+    result.ops = samples * opsPerSample;
+    result.seconds = seconds;
+    result.allocationsPerOp = result.ops > 0 ? static_cast<double>(allocations) / static_cast<double>(result.ops) : 0;
+    result.p50 = percentileOf(latencies, 0.50);
+    result.p90 = percentileOf(latencies, 0.90);
+    result.p99 = percentileOf(latencies, 0.99);
+    result.max = latencies.empty() ? 0 : latencies.back();
+    results.push_back(result);
+    printRow(std::cout, results.back());
+    return results.back();
+}
+
+void BenchSuite::printHeader(std::ostream& out) const {
+    out << std::left << std::setw(28) << "benchmark" << std::right << std::setw(10) << "users" << std::setw(10) << "ops"
+        << std::setw(14) << "ops/s" << std::setw(14) << "p50 ns" << std::setw(14) << "p90 ns" << std::setw(14) << "p99 ns"
+        << std::setw(12) << "allocs/op" << std::endl;
+}
+
+void BenchSuite::printRow(std::ostream& out, const BenchResult& result) const {
+    double opsPerSecond = result.seconds > 0 ? static_cast<double>(result.ops) / result.seconds : 0;
+    out << std::left << std::setw(28) << result.name << std::right << std::setw(10) << result.scale << std::setw(10)
+        << result.ops << std::fixed << std::setprecision(1) << std::setw(14) << opsPerSecond << std::setprecision(0)
+        << std::setw(14) << result.p50
+        << std::setw(14) << result.p90 << std::setw(14) << result.p99 << std::setprecision(2) << std::setw(12)
+        << result.allocationsPerOp << std::endl;
+    out.unsetf(std::ios::fixed);
+    out << std::setprecision(6);
+}
+
+bool BenchSuite::writeJson(const std::string& path, const std::string& benchmark) const {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error opening " << path << " for writing." << std::endl;
+        return false;
+    }
+    auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch());
+    out << "{\n  \"benchmark\": \"" << benchmark << "\",\n  \"timestamp\": " << now.count()
+        << ",\n  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n  \"results\": [";
+    out << std::fixed << std::setprecision(2);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& result = results[i];
+        double opsPerSecond = result.seconds > 0 ? static_cast<double>(result.ops) / result.seconds : 0;
+        out << (i ? ",\n" : "\n") << "    {\"name\": \"" << result.name << "\", \"scale\": " << result.scale
+            << ", \"ops\": " << result.ops << ", \"seconds\": " << std::setprecision(6) << result.seconds
+            << std::setprecision(2) << ", \"ops_per_second\": " << opsPerSecond
+            << ", \"p50_ns\": " << result.p50 << ", \"p90_ns\": " << result.p90 << ", \"p99_ns\": " << result.p99
+            << ", \"max_ns\": " << result.max << ", \"allocations_per_op\": " << result.allocationsPerOp << "}";
+    }
+    out << "\n  ]\n}\n";
+    out.close();
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,62 @@
+#ifndef BENCHHARNESS_H
+#define BENCHHARNESS_H
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// Every heap allocation made while 'countingAllocations' is set, on any thread. BenchHarness.cpp
+// replaces the global operator new to count them, so link it into one bench executable at most once.
+extern std::atomic<size_t> allocationCount;
+extern std::atomic<bool> countingAllocations;
+
+// Swallows output, e.g. FakeBook's load messages or a save path measured without a file system.
+class NullBuffer : public std::streambuf {
+public:
+    size_t bytes = 0;
+protected:
+    int overflow(int c) override {
+        ++bytes;
+        return c;
+    }
+    std::streamsize xsputn(const char*, std::streamsize count) override {
+        bytes += static_cast<size_t>(count);
+        return count;
+    }
+};
+
+// Prints a self-check's "[ok]" or "[FAIL]" line; a bench's main returns failedChecks() != 0.
+void check(const std::string& name, bool ok, const std::string& detail = "");
+int failedChecks();
+
+struct BenchResult {
+    std::string name;
+    size_t scale = 0; // users in the dataset
+    size_t ops = 0;
+    double seconds = 0;
+    double allocationsPerOp = 0;
+    // latency of one operation, in nanoseconds: each sample's time divided by its operations
+    double p50 = 0, p90 = 0, p99 = 0, max = 0;
+};
+
+/* A small microbenchmark harness. run() times 'samples' calls of 'body', each doing
+   'opsPerSample' operations, and keeps throughput, latency percentiles and allocations per
+   operation. Operations too short to time one by one (hash lookups, warm feed pages) are timed in
+   batches, so the percentiles are over batch means. 'setup' runs before every sample, untimed. */
+class BenchSuite {
+private:
+    std::vector<BenchResult> results;
+public:
+    const BenchResult& run(const std::string& name, size_t scale, size_t samples, size_t opsPerSample,
+                           const std::function<void(size_t sample)>& body,
+                           const std::function<void(size_t sample)>& setup = {});
+    void printHeader(std::ostream& out) const;
+    void printRow(std::ostream& out, const BenchResult& result) const;
+    // {"benchmark": ..., "hardware_threads": ..., "results": [{"name", "scale", "ops", ...}, ...]}
+    bool writeJson(const std::string& path, const std::string& benchmark) const;
+};
+#endif //BENCHHARNESS_H
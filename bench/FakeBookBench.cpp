@@ -0,0 +1,323 @@
+#include "BenchHarness.h"
+#include "DummyDataGenerator.h"
+#include "Fakebook.h"
+#include "User.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Sends std::cout to a NullBuffer while it lives; FakeBook reports every load and save there.
+class QuietCout {
+private:
+    NullBuffer sink;
+    std::streambuf* saved;
+public:
+    QuietCout() : saved(std::cout.rdbuf(&sink)) {}
+    ~QuietCout() { std::cout.rdbuf(saved); }
+};
+
+std::vector<size_t> parseScales(const std::string& text) {
+    std::vector<size_t> scales;
+    std::stringstream list(text);
+    std::string scale;
+    while (std::getline(list, scale, ','))
+        scales.push_back(static_cast<size_t>(std::strtoull(scale.c_str(), nullptr, 10)));
+    return scales;
+}
+
+FakeBookOptions benchOptions(bool useSnapshot, unsigned ingestThreads) {
+    FakeBookOptions options;
+    options.useSnapshot = useSnapshot;
+    options.ingestThreads = ingestThreads;
+    options.compactionIntervalSeconds = 0; // compaction only runs when a benchmark asks for it
+    return options;
+}
+
+// Every hot path at one dataset size, in the order a session meets them: load, lookups, feed
+// reads, answering friend requests, then persisting the changes.
+void benchScale(BenchSuite& suite, size_t scale) {
+    {
+        QuietCout quiet;
+        DummyDataOptions data;
+        data.userCount = static_cast<uint32_t>(scale);
+        data.averageDegree = 20;
+        data.seed = 42;
+        DummyDataGenerator generator(data);
+        generator.populateUsers();
+        generator.populateFriendsAndRequests();
+        generator.populatePosts();
+    }
+    // one full load is a second or more at a million users, so fewer samples there
+    size_t loadSamples = scale >= 1000000 ? 2 : scale >= 100000 ? 5 : 20;
+    std::unique_ptr<FakeBook> fakebook;
+    auto reload = [&](const FakeBookOptions& options) {
+        QuietCout quiet;
+        fakebook = std::make_unique<FakeBook>(options);
+    };
+    auto unload = [&](size_t) {
+        QuietCout quiet;
+        fakebook.reset();
+    };
+
+    suite.run("load.text", scale, loadSamples, 1, [&](size_t) { reload(benchOptions(false, 1)); }, unload);
+    suite.run("load.text.parallel", scale, loadSamples, 1, [&](size_t) { reload(benchOptions(false, 0)); }, unload);
+    suite.run("save.snapshot", scale, loadSamples, 1, [&](size_t) {
+        QuietCout quiet;
+        fakebook->saveSnapshot();
+    });
+    suite.run("load.snapshot", scale, loadSamples, 1, [&](size_t) { reload(benchOptions(true, 1)); }, unload);
+    std::filesystem::remove("DataStorage/FakeBook.snap");
+    check("load", fakebook->usernameToPointer("User" + std::to_string(scale)) != nullptr,
+          std::to_string(scale) + " users loaded");
+
+    std::vector<User*> users;
+    {
+        uint64_t state = 88172645463325252ULL;
+        for (size_t i = 0; i < 4096; ++i) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            users.push_back(fakebook->usernameToPointer("User" + std::to_string(state % scale + 1)));
+        }
+    }
+
+    const size_t lookupBatch = 64;
+    std::vector<std::string> names;
+    for (size_t i = 0; i < lookupBatch; ++i)
+        names.emplace_back(users[i]->getUserName());
+    size_t found = 0;
+    suite.run("lookup.username", scale, 2000, lookupBatch, [&](size_t) {
+        for (const std::string& name : names)
+            found += fakebook->usernameToPointer(name) != nullptr;
+    });
+
+    // the first page builds the reader's feed buffer, later pages are read from it
+    size_t feedSamples = std::min<size_t>(users.size(), 2000);
+    std::vector<FeedCursor> cursors(feedSamples);
+    size_t postsRead = 0;
+    suite.run("feed.first.cold", scale, feedSamples, 1, [&](size_t sample) {
+        FeedPage page = fakebook->getFeed(users[sample], 20);
+        cursors[sample] = page.next;
+        postsRead += page.posts.size();
+    });
+    suite.run("feed.first.warm", scale, feedSamples, 1, [&](size_t sample) {
+        postsRead += fakebook->getFeed(users[sample], 20).posts.size();
+    });
+    suite.run("feed.next", scale, feedSamples, 1, [&](size_t sample) {
+        postsRead += fakebook->getFeed(users[sample], 20, cursors[sample]).posts.size();
+    });
+
+    // generated posts read "This is post content no.N": N is a rare term, "post content" is in
+    // every post, so the phrase query runs until it fills a page the reader may see
+    std::vector<std::string> rareQueries, andQueries;
+    for (size_t i = 0; i < feedSamples; ++i) {
+        std::string number = std::to_string(i * 7919 % scale + 1);
+        rareQueries.push_back("no." + number);
+        andQueries.push_back("this " + number);
+    }
+    suite.run("search.rare", scale, feedSamples, 1, [&](size_t sample) {
+        postsRead += fakebook->searchPosts(users[sample], rareQueries[sample], 20).posts.size();
+    });
+    suite.run("search.and", scale, feedSamples, 1, [&](size_t sample) {
+        postsRead += fakebook->searchPosts(users[sample], andQueries[sample], 20).posts.size();
+    });
+    size_t phraseMatches = 0;
+    suite.run("search.phrase", scale, feedSamples, 1, [&](size_t sample) {
+        phraseMatches += fakebook->searchPosts(users[sample], "\"post content\"", 20).posts.size();
+    });
+    check("search", phraseMatches > 0, std::to_string(phraseMatches) + " phrase matches");
+
+    // generated names are User<n>: a prefix shared by about a hundred users, a whole name with two
+    // letters swapped, and one with its last digit mistyped
+    size_t suggested = 0;
+    std::vector<std::string> prefixes, typos, shortNames;
+    for (size_t i = 0; i < feedSamples; ++i) {
+        std::string name(users[i]->getUserName());
+        prefixes.push_back(name.substr(0, std::min(name.size(), std::to_string(scale).size() + 1)));
+        typos.push_back("Uesr" + name.substr(4));
+        shortNames.push_back(name.substr(0, name.size() - 1) + "x");
+    }
+    suite.run("suggest.prefix", scale, feedSamples, 1, [&](size_t sample) {
+        suggested += fakebook->suggestUsernames(users[sample], prefixes[sample], 10).size();
+    });
+    suite.run("suggest.typo", scale, feedSamples, 1, [&](size_t sample) {
+        suggested += fakebook->suggestUsernames(users[sample], typos[sample], 10).size();
+    });
+    suite.run("suggest.anonymous", scale, feedSamples, 1, [&](size_t sample) {
+        suggested += fakebook->suggestUsernames(nullptr, shortNames[sample], 10).size();
+    });
+    check("suggest", suggested > 0, std::to_string(suggested) + " usernames suggested");
+
+    // the menu's on-demand lookup, then the batch mode over every user; the counts must be exact
+    size_t recommended = 0, miscounted = 0;
+    suite.run("recommend.user", scale, feedSamples, 1, [&](size_t sample) {
+        recommended += fakebook->recommendFriends(users[sample], 10).size();
+    });
+    for (size_t i = 0; i < 100; ++i) {
+        for (const Recommendation& person : fakebook->recommendFriends(users[i], 10))
+            miscounted += users[i]->hasFriend(person.user) || users[i]->mutualFriendCount(person.user) != person.mutualFriends;
+    }
+    check("recommend", recommended > 0 && miscounted == 0,
+          std::to_string(recommended) + " recommended, " + std::to_string(miscounted) + " miscounted");
+    suite.run("recommend.all", scale, loadSamples, 1, [&](size_t) {
+        fakebook->saveRecommendations("DataStorage/Recommendations.txt", 10);
+    });
+
+    // degrees of separation between random pairs; every path must be a chain of friendships
+    size_t connected = 0, brokenPaths = 0;
+    suite.run("connect.random", scale, feedSamples, 1, [&](size_t sample) {
+        connected += !fakebook->findConnection(users[sample], users[users.size() - 1 - sample]).path.empty();
+    });
+    for (size_t i = 0; i < 100; ++i) {
+        Connection connection = fakebook->findConnection(users[i], users[users.size() - 1 - i]);
+        for (size_t j = 1; j < connection.path.size(); ++j)
+            brokenPaths += !connection.path[j - 1]->hasFriend(connection.path[j]);
+        if (!connection.path.empty())
+            brokenPaths += connection.path.front() != users[i] || connection.path.back() != users[users.size() - 1 - i];
+    }
+    check("connect", connected > 0 && brokenPaths == 0,
+          std::to_string(connected) + " connected, " + std::to_string(brokenPaths) + " broken paths");
+
+    // what handleRespondRequests does per request: list the pending senders, answer one
+    std::vector<User*> recipients = users;
+    std::sort(recipients.begin(), recipients.end());
+    recipients.erase(std::unique(recipients.begin(), recipients.end()), recipients.end());
+    std::vector<std::pair<User*, User*>> pending;
+    for (User* user : recipients) {
+        for (User* sender : fakebook->pendingRequestsTo(user))
+            pending.emplace_back(user, sender);
+    }
+    size_t requestSamples = std::min<size_t>(pending.size() / 2, 500);
+    suite.run("requests.list", scale, feedSamples, 1, [&](size_t sample) {
+        postsRead += fakebook->pendingRequestsTo(users[sample]).size();
+    });
+    if (requestSamples > 0) {
+        size_t answered = 0;
+        suite.run("requests.decline", scale, requestSamples, 1, [&](size_t sample) {
+            answered += fakebook->respondToRequest(pending[2 * sample].first, pending[2 * sample].second, false);
+        });
+        suite.run("requests.accept", scale, requestSamples, 1, [&](size_t sample) {
+            answered += fakebook->respondToRequest(pending[2 * sample + 1].first, pending[2 * sample + 1].second, true);
+        });
+        check("requests", answered == 2 * requestSamples, std::to_string(answered) + " answered");
+    }
+
+    // saveAllFriendsToFile and saveAllRequestsToFile, through the compaction that calls them
+    suite.run("save.friends", scale, loadSamples, 1, [&](size_t) {
+        QuietCout quiet;
+        fakebook->compactJournal();
+    }, [&](size_t sample) {
+        User* user = users[sample];
+        for (User* other : user->getFriends()) {
+            fakebook->removeFriend(user, other);
+            break;
+        }
+    });
+    check("reads", found == 2000 * lookupBatch && postsRead > 0,
+          std::to_string(found) + " lookups found, " + std::to_string(postsRead) + " posts and requests read");
+
+    // a compaction that dies between rewriting FriendRequests.txt and truncating the journal:
+    // replaying the journal must not add the declined request again or decline the one resent
+    User* from = users[0];
+    User* to = nullptr;
+    for (User* user : users) {
+        std::vector<User*> incoming = fakebook->pendingRequestsTo(user);
+        std::vector<User*> outgoing = fakebook->pendingRequestsTo(from);
+        if (user != from && !from->hasFriend(user) && std::find(incoming.begin(), incoming.end(), from) == incoming.end() &&
+            std::find(outgoing.begin(), outgoing.end(), user) == outgoing.end()) {
+            to = user;
+            break;
+        }
+    }
+    if (to != nullptr) {
+        std::string fromName(from->getUserName()), toName(to->getUserName());
+        std::string rowPrefix = std::string(from->getUserId()) + "#" + std::string(to->getUserId()) + "#";
+        auto countRows = [&]() {
+            std::ifstream requestFile("DataStorage/FriendRequests.txt");
+            size_t rows = 0;
+            for (std::string line; std::getline(requestFile, line);)
+                rows += line.compare(0, rowPrefix.size(), rowPrefix) == 0;
+            return rows;
+        };
+        bool sent = fakebook->sendRequest(from, to) == RequestOutcome::Sent && fakebook->respondToRequest(to, from, false) &&
+                    fakebook->sendRequest(from, to) == RequestOutcome::Sent;
+        std::filesystem::copy_file("DataStorage/Journal.log", "DataStorage/Journal.log.crash",
+                                   std::filesystem::copy_options::overwrite_existing);
+        {
+            QuietCout quiet;
+            fakebook->compactJournal();
+        }
+        size_t rowsFolded = countRows();
+        unload(0);
+        std::filesystem::rename("DataStorage/Journal.log.crash", "DataStorage/Journal.log");
+        reload(benchOptions(false, 1));
+        from = fakebook->usernameToPointer(fromName);
+        to = fakebook->usernameToPointer(toName);
+        std::vector<User*> incoming = fakebook->pendingRequestsTo(to);
+        size_t pendingAfter = static_cast<size_t>(std::count(incoming.begin(), incoming.end(), from));
+        {
+            QuietCout quiet;
+            fakebook->compactJournal();
+        }
+        size_t rowsReplayed = countRows();
+        check("journal.crash", sent && pendingAfter == 1 && rowsReplayed == rowsFolded,
+              std::to_string(pendingAfter) + " pending, " + std::to_string(rowsFolded) + " rows folded, " +
+              std::to_string(rowsReplayed) + " after replay");
+    }
+    unload(0);
+}
+
+/* The load, lookup, feed, request and persistence hot paths over generated datasets. Each scale
+   gets a fresh DummyDataGenerator dataset (seed 42, 20 friends and up to 10 posts per user) in
+   <data dir>/users-<scale>, removed afterwards unless --keep-data is given. Prints one row per
+   benchmark and writes every result to a JSON file, so runs can be diffed over time.
+
+   usage: fakebook_bench [--scales 1000,100000,1000000] [--json fakebook_bench.json]
+                         [--data-dir <dir>] [--keep-data] */
+int main(int argc, char* argv[]) {
+    std::vector<size_t> scales = {1000, 100000, 1000000};
+    std::filesystem::path jsonPath = "fakebook_bench.json";
+    std::filesystem::path dataDir = std::filesystem::temp_directory_path() / "fakebook_bench";
+    bool keepData = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--scales") == 0 && i + 1 < argc)
+            scales = parseScales(argv[++i]);
+        else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            jsonPath = argv[++i];
+        else if (std::strcmp(argv[i], "--data-dir") == 0 && i + 1 < argc)
+            dataDir = argv[++i];
+        else if (std::strcmp(argv[i], "--keep-data") == 0)
+            keepData = true;
+    }
+    jsonPath = std::filesystem::absolute(jsonPath);
+    dataDir = std::filesystem::absolute(dataDir);
+    std::filesystem::path startDir = std::filesystem::current_path();
+
+    BenchSuite suite;
+    suite.printHeader(std::cout);
+    for (size_t scale : scales) {
+        if (scale == 0)
+            continue;
+        std::filesystem::path root = dataDir / ("users-" + std::to_string(scale));
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root);
+        std::filesystem::current_path(root);
+        benchScale(suite, scale);
+        std::filesystem::current_path(startDir);
+        if (!keepData)
+            std::filesystem::remove_all(root);
+    }
+    if (!suite.writeJson(jsonPath.string(), "fakebook"))
+        return 1;
+    std::cout << "Results written to " << jsonPath.string() << std::endl;
+    return failedChecks() == 0 ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+#include "BenchHarness.h"
+#include "IdGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs 'threads' threads that each take 'perThread' IDs from their generator, and checks that
+// each thread saw strictly increasing IDs and that no ID was handed out twice overall.
+void run(const std::string& name, std::vector<IdGenerator*> generators, unsigned threads, size_t perThread) {
+    std::vector<std::vector<uint64_t>> taken(threads);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&taken, &generators, t, perThread]() {
+            IdGenerator& ids = *generators[t % generators.size()];
+            std::vector<uint64_t>& mine = taken[t];
+            mine.reserve(perThread);
+            for (size_t i = 0; i < perThread; ++i)
+                mine.push_back(ids.next());
+        });
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool increasing = true;
+    std::vector<uint64_t> all;
+    all.reserve(threads * perThread);
+    for (const std::vector<uint64_t>& mine : taken) {
+        increasing = increasing && std::is_sorted(mine.begin(), mine.end()) &&
+                     std::adjacent_find(mine.begin(), mine.end()) == mine.end();
+        all.insert(all.end(), mine.begin(), mine.end());
+    }
+    std::sort(all.begin(), all.end());
+    size_t duplicates = all.size() - static_cast<size_t>(std::unique(all.begin(), all.end()) - all.begin());
+
+    check(name, increasing && duplicates == 0,
+          std::to_string(all.size()) + " IDs from " + std::to_string(threads) + " threads, " +
+          std::to_string(duplicates) + " duplicates, " + (increasing ? "" : "NOT ") + "increasing per thread, " +
+          std::to_string(static_cast<double>(all.size()) / seconds / 1e6) + " M IDs/s");
+}
+
+/* Uniqueness under contention:
+     - one shared generator hammered by every core;
+     - several generators with different worker numbers, which must never collide;
+     - IDs carry their worker and a creation time close to now. */
+int main() {
+    unsigned threads = std::max(4u, std::thread::hardware_concurrency());
+    size_t perThread = 2000000;
+
+    IdGenerator shared(1);
+    run("shared generator", {&shared}, threads, perThread);
+
+    IdGenerator first(2), second(3), third(IdGenerator::MAX_WORKER);
+    run("one generator per worker", {&first, &second, &third}, threads, perThread / 2);
+
+    uint64_t id = shared.next();
+    auto age = std::chrono::system_clock::now() - IdGenerator::timeOf(id);
+    check("ID fields", IdGenerator::workerOf(id) == 1 && IdGenerator::workerOf(third.next()) == IdGenerator::MAX_WORKER &&
+                       age < std::chrono::minutes(1),
+          "worker and timestamp decode back");
+    return failedChecks() == 0 ? 0 : 1;
+}
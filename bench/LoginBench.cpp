@@ -0,0 +1,125 @@
+#include "Arena.h"
+#include "Authenticator.h"
+#include "BenchHarness.h"
+#include "Credential.h"
+#include "StringPool.h"
+#include "User.h"
+#include "UserDirectory.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+std::string toHex(const Sha256Digest& digest) {
+    std::string out;
+    const char* digits = "0123456789abcdef";
+    for (uint8_t byte : digest) {
+        out.push_back(digits[byte >> 4]);
+        out.push_back(digits[byte & 0xf]);
+    }
+    return out;
+}
+
+double percentile(std::vector<double>& sorted, double fraction) {
+    size_t index = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1));
+    return sorted[index];
+}
+
+/* Login latency under a burst: every attempt is queued at once, as if 10k clients pressed
+   "Login" together, and each attempt's latency runs from its submission to its result. The pool
+   is FIFO, so results are collected in submission order. Past 'max queued' waiting logins the
+   Authenticator answers busy at once; those attempts are counted, not timed.
+
+   usage: fakebook_login_bench [iterations] [hash threads] [attempts] [max queued, 0 = no limit]
+   The default work factor is lower than FakeBook's so the burst finishes in seconds; latency
+   scales linearly with it. */
+int main(int argc, char* argv[]) {
+    uint32_t iterations = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 1000;
+    unsigned hashThreads = argc > 2 ? static_cast<unsigned>(std::max(1, std::atoi(argv[2]))) : 2;
+    size_t attempts = argc > 3 ? static_cast<size_t>(std::atoll(argv[3])) : 10000;
+    size_t maxQueued = argc > 4 ? static_cast<size_t>(std::atoll(argv[4])) : 64;
+
+    // known answers: FIPS 180-2 and RFC 7914 section 11
+    check("sha256", toHex(sha256("abc")) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    const uint8_t salt[] = {'s', 'a', 'l', 't'};
+    check("pbkdf2, 1 iteration", toHex(pbkdf2HmacSha256("password", salt, sizeof(salt), 1)) ==
+                                     "120fb6cffcf8b32c43e7225256c4f837a86548c92ccc35480805987cb70be17b");
+    check("pbkdf2, 4096 iterations", toHex(pbkdf2HmacSha256("password", salt, sizeof(salt), 4096)) ==
+                                         "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a");
+
+    Credential hashed = Credential::derive("Pass1", iterations);
+    Credential reparsed = Credential::parse(hashed.stored());
+    Credential legacy = Credential::parse("Pass1");
+    check("credential round trip", !hashed.isLegacy() && reparsed.stored() == hashed.stored() && reparsed.verify("Pass1") &&
+                                       !reparsed.verify("Pass2") && !reparsed.verify(""));
+    check("legacy credential", legacy.isLegacy() && legacy.verify("Pass1") && !legacy.verify("Pass") && !legacy.verify("Pass11"));
+
+    // half the users are already hashed, half are legacy plaintext rows
+    const size_t userCount = 2000;
+    StringPool strings;
+    Arena<User> users;
+    UserDirectory directory(strings);
+    auto epoch = std::chrono::system_clock::time_point(std::chrono::seconds(1762600000));
+    for (size_t i = 0; i < userCount; ++i) {
+        std::string password = "Pass" + std::to_string(i);
+        Credential credential = i % 2 == 0 ? Credential::parse(password) : Credential::derive(password, iterations);
+        directory.add(users.create(strings, "User" + std::to_string(i), "u" + std::to_string(i),
+                                   "user" + std::to_string(i) + "@fakebook.com", std::move(credential), 20, 'F', "Country",
+                                   true, epoch));
+    }
+
+    Authenticator auth("/dev/null", hashThreads, iterations, maxQueued);
+    auto singleStart = std::chrono::steady_clock::now();
+    LoginResult single = auth.authenticate(directory, "user1@fakebook.com", "Pass1").get();
+    double singleMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - singleStart).count();
+    check("single login", single.user != nullptr && !single.upgraded, std::to_string(singleMs) + " ms");
+    check("legacy login is upgraded", auth.authenticate(directory, "user0@fakebook.com", "Pass0").get().upgraded.has_value());
+
+    // 1 in 10 attempts uses a wrong password, 1 in 20 an unknown email
+    std::vector<std::future<LoginResult>> pending;
+    std::vector<std::chrono::steady_clock::time_point> submitted;
+    std::vector<bool> shouldSucceed;
+    pending.reserve(attempts);
+    submitted.reserve(attempts);
+    auto burstStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < attempts; ++i) {
+        size_t user = (i * 7919) % userCount;
+        bool wrongPassword = i % 10 == 3;
+        bool unknownEmail = i % 20 == 7;
+        std::string email = unknownEmail ? "nobody" + std::to_string(i) + "@fakebook.com" : "user" + std::to_string(user) + "@fakebook.com";
+        std::string password = "Pass" + std::to_string(user) + (wrongPassword ? "x" : "");
+        submitted.push_back(std::chrono::steady_clock::now());
+        pending.push_back(auth.authenticate(directory, std::move(email), std::move(password)));
+        shouldSucceed.push_back(!wrongPassword && !unknownEmail);
+    }
+    std::vector<double> latencies;
+    latencies.reserve(attempts);
+    size_t wrongOutcomes = 0, busy = 0;
+    for (size_t i = 0; i < attempts; ++i) {
+        LoginResult result = pending[i].get();
+        if (result.busy) {
+            ++busy;
+            continue;
+        }
+        latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - submitted[i]).count());
+        if ((result.user != nullptr) != shouldSucceed[i])
+            ++wrongOutcomes;
+    }
+    double burstSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - burstStart).count();
+    std::sort(latencies.begin(), latencies.end());
+
+    size_t admitted = attempts - busy;
+    check("burst outcomes", wrongOutcomes == 0, std::to_string(wrongOutcomes) + " wrong of " + std::to_string(admitted));
+    check("burst admission", maxQueued == 0 ? busy == 0 : admitted >= std::min(attempts, maxQueued) && (busy > 0) == (attempts > admitted),
+          std::to_string(admitted) + " admitted, " + std::to_string(busy) + " turned away busy");
+    std::cout << "login burst: " << attempts << " attempts, " << iterations << " iterations, " << hashThreads
+              << " hash threads, " << busy << " busy; admitted p50 " << percentile(latencies, 0.50) << " ms, p99 " << percentile(latencies, 0.99)
+              << " ms, max " << latencies.back() << " ms, " << static_cast<double>(attempts) / burstSeconds << " attempts/s"
+              << std::endl;
+    return failedChecks() == 0 ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+#include "BenchHarness.h"
+#include "Fakebook.h"
+#include "User.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes a DataStorage with 'userCount' users, each befriending 'degree' random others and
+// writing 'postsPerUser' posts.
+void writeDataStorage(const std::filesystem::path& root, uint32_t userCount, uint32_t degree, uint32_t postsPerUser) {
+    std::filesystem::create_directories(root / "DataStorage");
+    std::mt19937 random(42);
+    std::ofstream users(root / "DataStorage/Users.txt");
+    for (uint32_t i = 1; i <= userCount; ++i) {
+        users << 'u' << i << "#User" << i << "#user" << i << "@fakebook.com#Pass" << i << "#Country#"
+              << (i % 2 ? 'F' : 'M') << '#' << 18 + i % 50 << '#' << (i % 4 ? "Public" : "Private") << "#1762600000\n";
+    }
+    std::vector<std::vector<uint32_t>> friends(userCount + 1);
+    std::uniform_int_distribution<uint32_t> anyUser(1, userCount);
+    for (uint32_t i = 1; i <= userCount; ++i) {
+        for (uint32_t k = 0; k < degree / 2; ++k) {
+            uint32_t other = anyUser(random);
+            if (other == i || std::find(friends[i].begin(), friends[i].end(), other) != friends[i].end())
+                continue;
+            friends[i].push_back(other);
+            friends[other].push_back(i);
+        }
+    }
+    std::ofstream friendFile(root / "DataStorage/Friends.txt");
+    for (uint32_t i = 1; i <= userCount; ++i) {
+        friendFile << 'u' << i << ':';
+        for (size_t k = 0; k < friends[i].size(); ++k)
+            friendFile << (k ? "," : "") << 'u' << friends[i][k];
+        friendFile << '\n';
+    }
+    std::ofstream posts(root / "DataStorage/Posts.txt");
+    uint64_t postId = 1;
+    for (uint32_t i = 1; i <= userCount; ++i) {
+        for (uint32_t k = 0; k < postsPerUser; ++k, ++postId) {
+            posts << 'p' << postId << "#u" << i << "#post " << postId << '#' << 1762000000 + postId * 7 % 900000 << '#'
+                  << (postId % 3 ? "Public" : "FriendsOnly") << '\n';
+        }
+    }
+    std::ofstream(root / "DataStorage/FriendRequests.txt");
+}
+
+// One read as a session would issue it: the first feed page, half the time the second one too,
+// then a profile. Returns the number of posts seen.
+size_t readOnce(FakeBook& fakebook, const std::vector<User*>& users, std::mt19937& random) {
+    User* viewer = users[random() % users.size()];
+    FeedPage page = fakebook.getFeed(viewer, 20);
+    size_t seen = page.posts.size();
+    if (page.hasMore && random() % 2 == 0)
+        seen += fakebook.getFeed(viewer, 20, page.next).posts.size();
+    seen += fakebook.viewProfile(viewer, users[random() % users.size()]).posts.size();
+    return seen;
+}
+
+struct Throughput {
+    double reads;
+    double writes;
+};
+
+// 'readers' threads read for 'seconds' while 'writers' threads post and add/remove friends.
+Throughput runFor(FakeBook& fakebook, const std::vector<User*>& users, unsigned readers, unsigned writers, double seconds) {
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> reads{0}, writes{0}, seen{0}; // 'seen' keeps the reads' results alive
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < readers; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 random(t + 1);
+            size_t done = 0, mine = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                mine += readOnce(fakebook, users, random);
+                ++done;
+            }
+            reads += done;
+            seen += mine;
+        });
+    }
+    for (unsigned t = 0; t < writers; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 random(1000 + t);
+            size_t done = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                User* user = users[random() % users.size()];
+                User* other = users[random() % users.size()];
+                if (done % 4 == 0 && user != other) {
+                    if (fakebook.sendRequest(user, other) == RequestOutcome::AlreadyFriends)
+                        fakebook.removeFriend(user, other);
+                    else
+                        fakebook.respondToRequest(other, user, true);
+                } else {
+                    fakebook.createPost(user, {"bench post", done % 2 == 0});
+                }
+                ++done;
+            }
+            writes += done;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (std::thread& thread : threads)
+        thread.join();
+    return {static_cast<double>(reads.load()) / seconds, static_cast<double>(writes.load()) / seconds};
+}
+
+/* Multi-session scaling:
+     - feed pages read concurrently are the same as read one at a time;
+     - read throughput from 1 to 32 threads, as speedup over one thread. Reads take one shard of
+       FakeBook's state lock, so on a machine with that many cores the speedup should track the
+       thread count; beyond the core count it can only flatten;
+     - the same reads with one writer thread posting and changing friendships.
+
+   usage: fakebook_session_bench [users] [seconds per step] */
+int main(int argc, char* argv[]) {
+    uint32_t userCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 20000;
+    double seconds = argc > 2 ? std::atof(argv[2]) : 1.0;
+
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "fakebook_session_bench";
+    std::filesystem::remove_all(root);
+    writeDataStorage(root, userCount, 20, 10);
+    std::filesystem::current_path(root);
+
+    FakeBookOptions options;
+    options.useSnapshot = false;
+    options.compactionIntervalSeconds = 0;
+    FakeBook fakebook(options);
+    std::vector<User*> users;
+    for (uint32_t i = 1; i <= userCount; ++i)
+        users.push_back(fakebook.usernameToPointer("User" + std::to_string(i)));
+
+    // 8 threads read the same cold feeds at once, racing to build their buffers; one thread then
+    // reads them again from the buffers that won
+    const size_t sampleCount = 500;
+    std::vector<std::vector<uint32_t>> concurrent(sampleCount);
+    std::vector<std::thread> checkers;
+    for (unsigned t = 0; t < 8; ++t) {
+        checkers.emplace_back([&, t]() {
+            for (size_t i = 0; i < sampleCount; ++i) {
+                std::vector<uint32_t> page = fakebook.getFeed(users[i * 37 % users.size()], 20).posts;
+                if (i % 8 == t)
+                    concurrent[i] = std::move(page);
+            }
+        });
+    }
+    for (std::thread& checker : checkers)
+        checker.join();
+    size_t mismatches = 0;
+    for (size_t i = 0; i < sampleCount; ++i) {
+        if (fakebook.getFeed(users[i * 37 % users.size()], 20).posts != concurrent[i])
+            ++mismatches;
+    }
+    check("concurrent feed pages", mismatches == 0, std::to_string(mismatches) + " of " + std::to_string(sampleCount) + " differ");
+
+    // build every lazily built feed buffer first, so the first step doesn't pay for the rest
+    for (User* user : users)
+        fakebook.getFeed(user, 20);
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "read scaling, " << userCount << " users, " << cores << " hardware threads:" << std::endl;
+    double single = 0;
+    for (unsigned threads : {1u, 2u, 4u, 8u, 16u, 32u}) {
+        Throughput result = runFor(fakebook, users, threads, 0, seconds);
+        if (threads == 1)
+            single = result.reads;
+        std::cout << "  " << threads << " threads: " << static_cast<size_t>(result.reads) << " reads/s, speedup "
+                  << result.reads / single << " (ideal " << std::min(threads, cores) << ")" << std::endl;
+    }
+    for (unsigned threads : {1u, std::min(32u, std::max(2u, cores))}) {
+        Throughput result = runFor(fakebook, users, threads, 1, seconds);
+        std::cout << "  " << threads << " readers + 1 writer: " << static_cast<size_t>(result.reads) << " reads/s, "
+                  << static_cast<size_t>(result.writes) << " writes/s" << std::endl;
+    }
+
+    std::filesystem::current_path(root.parent_path());
+    std::filesystem::remove_all(root);
+    return failedChecks() == 0 ? 0 : 1;
+}
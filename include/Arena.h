@@ -0,0 +1,80 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+/* Owns every object of one type in large slabs. Objects are placed back to back in creation
+   order and never move, so the pointers handed out stay valid until clear(), which destroys
+   them all and returns the slabs in one go. There is no per-object delete. Not thread-safe. */
+template <typename T>
+class Arena {
+private:
+    struct Slab {
+        T* objects;
+        size_t used;
+        size_t capacity;
+    };
+
+    std::vector<Slab> slabs;
+    size_t objectsPerSlab;
+    size_t count = 0;
+
+    void addSlab(size_t capacity) {
+        T* objects = static_cast<T*>(::operator new(capacity * sizeof(T), std::align_val_t(alignof(T))));
+        slabs.push_back({objects, 0, capacity});
+    }
+public:
+    explicit Arena(size_t _objectsPerSlab = 4096) : objectsPerSlab(_objectsPerSlab) {}
+    ~Arena() { clear(); }
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&& other) noexcept
+        : slabs(std::move(other.slabs)), objectsPerSlab(other.objectsPerSlab), count(other.count) {
+        other.slabs.clear();
+        other.count = 0;
+    }
+    Arena& operator=(Arena&& other) noexcept {
+        if (this != &other) {
+            clear();
+            slabs = std::move(other.slabs);
+            objectsPerSlab = other.objectsPerSlab;
+            count = other.count;
+            other.slabs.clear();
+            other.count = 0;
+        }
+        return *this;
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (slabs.empty() || slabs.back().used == slabs.back().capacity)
+            addSlab(objectsPerSlab);
+        Slab& slab = slabs.back();
+        T* object = new (slab.objects + slab.used) T(std::forward<Args>(args)...);
+        ++slab.used;
+        ++count;
+        return object;
+    }
+
+    // Makes room for 'additional' more objects in one contiguous slab, for bulk loads.
+    void reserve(size_t additional) {
+        if (!slabs.empty() && slabs.back().capacity - slabs.back().used >= additional)
+            return;
+        addSlab(additional > objectsPerSlab ? additional : objectsPerSlab);
+    }
+
+    void clear() {
+        for (Slab& slab : slabs) {
+            for (size_t i = 0; i < slab.used; ++i)
+                slab.objects[i].~T();
+            ::operator delete(slab.objects, std::align_val_t(alignof(T)));
+        }
+        slabs.clear();
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+};
+#endif //ARENA_H
@@ -1,15 +1,61 @@
 #ifndef AUTHENTICATOR_H
 #define AUTHENTICATOR_H
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
+#include "Arena.h"
+#include "Credential.h"
+#include "StringPool.h"
+#include "ThreadPool.h"
 class User;
+class UserDirectory;
+class IdGenerator;
 
+// 'upgraded' is set when the login succeeded against a legacy plaintext row or a hash with a
+// lower work factor than configured; the caller stores it in place of the old credential.
+// 'busy' is set, and nothing was checked, when too many logins were already waiting to be hashed.
+struct LoginResult {
+    User* user = nullptr;
+    std::optional<Credential> upgraded;
+    bool busy = false;
+};
+
+// The fields of a new account, as typed at the sign-up prompt or read from a batch script.
+struct SignUpForm {
+    std::string username;
+    std::string email;
+    std::string password;
+    std::string location;
+    int age = 0;
+    char gender = 'M';
+    bool isPublic = true;
+};
+
+/* Password hashing is deliberately slow, so it runs on a small fixed pool of its own: a burst of
+   logins queues there instead of taking every core from the rest of the program. The queue is
+   bounded too: past maxQueuedLogins waiting or running logins, authenticate() answers 'busy' at
+   once, so callers that wait on the result, e.g. session workers, aren't all parked behind it.
+   With no hash threads nothing can be hashed, so authenticate() and hashPassword() must not be
+   called; that is for loads that never log anyone in. */
 class Authenticator{
 private:
     std::string fileName;
+    uint32_t iterations;
+    size_t maxQueuedLogins; // 0 = no limit
+    std::atomic<size_t> queuedLogins{0};
+    ThreadPool hashPool;
 public:
-    Authenticator(std::string _fileName);
-    User* login(std::vector<User*>& userList);
-    User* signUp(std::vector<User*>& userList);
+    Authenticator(std::string _fileName, unsigned hashThreads, uint32_t _iterations, size_t _maxQueuedLogins = 0);
+    std::future<LoginResult> authenticate(const UserDirectory& directory, std::string email, std::string password);
+    std::future<Credential> hashPassword(std::string password);
+    static SignUpForm promptSignUp();
+    // Returns nullptr when the email is already taken or Users.txt can't be appended to.
+    User* signUp(const SignUpForm& form, Credential credential, Arena<User>& users, StringPool& strings,
+                 IdGenerator& ids, std::vector<User*>& userList, UserDirectory& directory);
 };
 #endif //AUTHENTICATOR_H
@@ -0,0 +1,78 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Timeline.h"
+class FakeBook;
+class User;
+
+enum class BatchOp { Login, SignUp, Logout, Post, Request, Accept, Decline, Unfriend, Feed, More, Profile, Privacy, Search, Suggest, Recommend, Connect, Count };
+
+constexpr size_t MAX_COMMAND_FIELDS = 9;
+
+// How a command went: FakeBook did it, refused it, or turned a LOGIN away because too many were
+// already waiting to be hashed.
+enum class CommandResult { Ok, Failed, Busy };
+
+// One script or server session: who is logged in and where their feed paging stands.
+struct CommandSession {
+    User* user = nullptr;
+    FeedCursor cursor;
+};
+
+const char* batchOpName(BatchOp op);
+// Splits one script line into its command and '#'-separated fields, which point into 'line'.
+// False for a line that isn't a well-formed command.
+bool parseCommand(std::string_view line, BatchOp& op, std::string_view* fields);
+// Runs one parsed command for 'session', which must be logged in unless it is LOGIN or SIGNUP.
+// 'shown' receives the PostStore rows a FEED, MORE, PROFILE or SEARCH returned. Failed when
+// FakeBook refused the command (wrong password, not friends, empty page, ...).
+CommandResult executeCommand(FakeBook& fakebook, CommandSession& session, BatchOp op, const std::string_view* fields,
+                    std::vector<uint32_t>& shown);
+
+struct BatchOpStats {
+    size_t ops = 0;
+    size_t failed = 0; // ran, but the API refused it (wrong password, not friends, ...)
+    size_t busy = 0;   // LOGINs turned away because the hash queue was full
+    std::chrono::steady_clock::duration elapsed{};
+};
+
+/* Replays a command script against FakeBook's API with one session, the way the menu would but
+   without prompts, and times each command. One command per line, fields separated by '#' like
+   the DataStorage files:
+
+     LOGIN#email#password            SIGNUP#username#email#password#location#age#M|F#Public|Private
+     LOGOUT                          POST#Public|Friends#content
+     REQUEST#username                ACCEPT#username         DECLINE#username
+     UNFRIEND#username               PROFILE#username        PRIVACY#Public|Private
+     FEED#limit                      first page of the home feed
+     MORE#limit                      the page after the previous FEED or MORE
+     SEARCH#limit#query              posts matching query, most recently loaded first, see FakeBook::searchPosts
+     SUGGEST#limit#typed             usernames completing typed, see FakeBook::suggestUsernames
+     RECOMMEND#limit                 people the user may know, see FakeBook::recommendFriends
+     CONNECT#username                shortest chain of friends to username, see FakeBook::findConnection
+
+   A POST whose content holds a '#' fails, since the content couldn't be stored.
+   Blank lines and lines starting with "//" are skipped. Anything else that doesn't parse, and
+   any command but LOGIN or SIGNUP while logged out, is counted as skipped and not timed. */
+class BatchRunner {
+private:
+    static constexpr size_t OP_COUNT = static_cast<size_t>(BatchOp::Count);
+
+    FakeBook& fakebook;
+    CommandSession session;
+    std::array<BatchOpStats, OP_COUNT> stats{};
+    size_t skipped = 0;
+    size_t postsRead = 0; // feed, profile and search posts returned, so the reads do observable work
+    std::chrono::steady_clock::duration total{};
+public:
+    explicit BatchRunner(FakeBook& _fakebook);
+    bool run(const std::string& scriptPath);
+    void printReport(std::ostream& out) const;
+};
+#endif //BATCHRUNNER_H
@@ -0,0 +1,34 @@
+#ifndef CONNECTIONFINDER_H
+#define CONNECTIONFINDER_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+class FriendGraph;
+class User;
+
+struct Connection {
+    std::vector<User*> path;          // the user first, the target last; empty when not connected within the hop limit
+    std::vector<User*> mutualFriends; // friends of both, in graph order
+    size_t visited = 0;               // users the search reached
+};
+
+/* Degrees of separation: a shortest chain of friendships between two users, found by a
+   breadth-first search from both ends that stops where the two meet.
+
+   Each round expands one whole level, on whichever side has fewer friendships left to walk, so a
+   hub's long row is put off while the other side is cheaper. Users reached are marked in a bitmap
+   per side, one bit per graph node, and the levels are kept as lists so the path is traced back
+   through them instead of storing a parent per node. Bitmaps and lists are per thread and reused,
+   clearing only what the last query set, so a warm query allocates nothing. The search gives up
+   once the two sides together have gone maxHops deep.
+
+   Only reads the graph; callers hold FakeBook's stateLock shared. */
+class ConnectionFinder {
+private:
+    const FriendGraph& graph;
+    uint32_t maxHops;
+public:
+    ConnectionFinder(const FriendGraph& _graph, uint32_t _maxHops);
+    Connection find(const User* from, const User* to) const;
+};
+#endif //CONNECTIONFINDER_H
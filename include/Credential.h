@@ -0,0 +1,42 @@
+#ifndef CREDENTIAL_H
+#define CREDENTIAL_H
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using Sha256Digest = std::array<uint8_t, 32>;
+
+Sha256Digest sha256(std::string_view data);
+// PBKDF2-HMAC-SHA256 with a single 32-byte output block (RFC 8018).
+Sha256Digest pbkdf2HmacSha256(std::string_view password, const uint8_t* salt, size_t saltLength, uint32_t iterations);
+// Runs in time that depends only on 'length', never on where the inputs differ.
+bool constantTimeEquals(const uint8_t* a, const uint8_t* b, size_t length);
+
+/* A user's password as it is kept in memory, in Users.txt and in the snapshot:
+
+     pbkdf2-sha256$<iterations>$<salt, hex>$<hash, hex>
+
+   Any other password field is a legacy plaintext row from before passwords were hashed. It still
+   verifies, and the next successful login replaces it with a hash (see FakeBook::upgradeCredential),
+   as it does for a hash made with fewer iterations than currently configured. */
+class Credential {
+public:
+    static constexpr size_t SALT_BYTES = 16;
+private:
+    uint32_t iterations = 0; // 0 for a legacy plaintext row
+    std::array<uint8_t, SALT_BYTES> salt{};
+    Sha256Digest hash{};
+    std::string legacyPassword;
+public:
+    static Credential parse(std::string_view stored);
+    // Hashes 'password' with a fresh random salt. Deliberately slow: 'iterations' is the work factor.
+    static Credential derive(std::string_view password, uint32_t iterations);
+
+    bool verify(std::string_view password) const;
+    bool isLegacy() const { return iterations == 0; }
+    uint32_t workFactor() const { return iterations; }
+    std::string stored() const;
+};
+#endif //CREDENTIAL_H
@@ -1,29 +1,52 @@
 #ifndef DUMMYDATAGENERATOR_H
 #define DUMMYDATAGENERATOR_H
-#include <chrono>
-#include <random>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
 #include <vector>
+#include "ThreadPool.h"
 
+struct DummyDataOptions {
+    uint32_t userCount = 20;
+    uint32_t maxPostsPerUser = 10;  // each user writes 0..maxPostsPerUser posts
+    uint32_t averageDegree = 6;     // friendships per user before duplicates are dropped
+    uint32_t requestPercent = 10;   // share of generated pairs written as pending requests instead
+    uint64_t seed = 0;              // 0 = seed from the clock
+    unsigned threads = 0;           // 0 = one per core
+};
+
+/* Writes a random DataStorage of any size, streamed out in chunks built in parallel:
+
+     userId#username#email#password#location#gender#age#isPublic#createdAt  for Users.txt
+     userId:friendId1,friendId2,... for Friends.txt
+     postId#authorId#text#timestamp#visibility  for Posts.txt
+     fromUserId#toUserId#timestamp#status  for FriendRequests.txt
+
+   User number i (1-based) is User<i>, user<i>@fakebook.com with password Pass<i>, so load scripts
+   can log in as anyone. Its userId is a fixed permutation of i, so ID order isn't username order.
+   Each friendship starts at a uniformly chosen user and draws only its other end R-MAT style, so
+   everyone makes about averageDegree / 2 friends while popularity follows a power law with a few
+   very popular users; user 1 is the most popular. That takes O(edges) time and memory, and nothing
+   else is kept per user. Every
+   chunk draws from its own generator seeded from 'seed' and the chunk number, so a seed gives the
+   same users, friendships and posts on any thread count; only timestamps, which count back from
+   the time of the run, differ. */
 class DummyDataGenerator {
 private:
-    /* userId#username#email#password#location#gender#age#isPublic#createdAt  for User.txt
-       userId:friendId1,friendId2,... for Friends.txt
-       postId#authorId#text#timestamp#visibility  for Posts.txt
-       fromUserId#toUserId#timestamp#status  for FriendRequests.txt*/
+    DummyDataOptions options;
+    long long now; // seconds since the epoch, when the generator was created
+    uint64_t idMultiplier = 1; // userIdOf is (index * idMultiplier + idOffset) mod userCount
+    uint64_t idOffset = 0;
+    mutable ThreadPool pool;
 
-    // age, gender, isPublicProfile, isPublicPost can all be done within the methods and don't need their own pools
-    std::mt19937 randomizer;
-    std::vector<std::string> userIdPool; // can also work as authorId
-    std::vector<std::string> usernamePool;
-    std::vector<std::string> emailPool;
-    std::vector<std::string> passwordPool;
-    std::vector<std::string> locationPool;
-    std::vector<std::chrono::system_clock::time_point> userCreatedAtPool;
-    std::vector<std::chrono::system_clock::time_point> PostCreatedAtPool;
-    std::vector<std::string> postIdPool;
-    std::vector<std::string> contentPool;
+    uint32_t userIdOf(uint32_t index) const;
+    uint64_t chunkSeed(uint64_t stream, size_t chunk) const;
+    // Builds chunk 0..chunkCount-1 on the pool and writes them to 'path' in order, with only a
+    // few chunks in memory at a time.
+    bool writeChunks(const std::string& path, size_t chunkCount, const std::function<std::string(size_t)>& makeChunk) const;
 public:
-    DummyDataGenerator();
+    explicit DummyDataGenerator(const DummyDataOptions& _options = {});
     void populateUsers();
     void populatePosts();
     void populateFriendsAndRequests();
@@ -3,30 +3,196 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "Arena.h"
+#include "Authenticator.h"
+#include "StringPool.h"
+#include "UserDirectory.h"
+#include "UsernameIndex.h"
+#include "FriendGraph.h"
+#include "FriendRecommender.h"
+#include "ConnectionFinder.h"
+#include "GraphAnalytics.h"
+#include "PostStore.h"
+#include "PostIndex.h"
+#include "FriendRequestStore.h"
+#include "IdGenerator.h"
+#include "Journal.h"
+#include "MappedFile.h"
+#include "Timeline.h"
+#include "ShardedSharedMutex.h"
 
 class User;
-class Post;
+struct PostDraft;
+struct ProfileView;
+class ThreadPool;
+class MetricsExporter;
+
+enum class RequestOutcome {
+    Sent,
+    BecameFriends, // the other user had already sent one, so it was accepted instead
+    AlreadyFriends,
+    AlreadySent,
+    ToSelf
+};
+
+// createPost's result when the content can't be stored: '#' separates the fields of Posts.txt
+// and the journal, and a newline ends the record.
+const uint32_t NO_POST = UINT32_MAX;
+
+struct FakeBookOptions {
+    unsigned ingestThreads = 1; // threads used to parse DataStorage, 1 = serial, 0 = one per core
+    bool useSnapshot = true;    // load from / save to DataStorage/FakeBook.snap when it is up to date
+    unsigned compactionIntervalSeconds = 30; // how often the journal is folded into the base files, 0 = only at quit
+    size_t feedCapacity = 200;          // posts kept per precomputed home feed
+    size_t feedPageSize = 20;           // posts shown per page of the home feed
+    size_t celebrityThreshold = 1000;   // users with more friends are pulled at read time instead of fanned out
+    uint32_t workerId = 0;              // worker field of generated IDs, unique per concurrently running instance
+    unsigned hashThreads = 2;           // threads that hash passwords for login and sign-up
+    size_t maxQueuedLogins = 64;        // logins waiting for or on a hash thread before more are turned away, 0 = no limit
+    uint32_t passwordIterations = 100000; // PBKDF2 work factor for newly stored passwords
+    std::string metricsFile;            // enables Metrics and dumps them here in Prometheus text format
+    unsigned metricsIntervalSeconds = 10; // how often metricsFile is rewritten
+    RecommendationWeights recommendationWeights; // how "people you may know" are ranked
+    uint32_t maxSeparation = 6;                  // friendship hops findConnection searches before giving up
+    // Load and read only, for offline jobs next to a live server: the journal is replayed but
+    // never created, appended to or truncated, compaction and snapshot saves are off, and no
+    // password hash threads are started, so login and sign-up fail.
+    bool readOnly = false;
+    bool searchIndexes = true;          // index posts and usernames at load; offline jobs that never search skip it
+};
 
 class FakeBook {
 private:
+    FakeBookOptions options;
     User* currentSession = nullptr;
+    MappedFile snapshotMapping; // the loaded snapshot, when there is one; strings and posts view into it
+    StringPool strings; // userIds, usernames, emails and locations
+    Arena<User> userArena; // owns every User, masterUserList is the load order
     std::vector<User*> masterUserList;
-    std::vector<Post*> masterPostList;
+    UserDirectory userDirectory;
+    UsernameIndex usernames; // for suggestUsernames
+    FriendGraph friendGraph;
+    FriendRecommender recommender; // over friendGraph, for recommendFriends
+    ConnectionFinder connections;  // over friendGraph, for findConnection
+    PostStore posts; // every post, rows in load order
+    PostIndex postIndex; // words of every post, for searchPosts
+    std::unique_ptr<ThreadPool> ingestPool; // only created for parallel ingest
+    IdGenerator ids; // user, post and friend request IDs
+    FriendRequestStore friendRequests;
+    TimelineService timelines;
+    Authenticator auth;
+
+    // Mutations are appended to the journal and folded into the base files by compaction.
+    //
+    // Locking, for many sessions on many threads:
+    //   - stateLock is held shared, on the shard of the user being read for, by feed, profile and
+    //     lookup reads. Any one shard keeps every writer out.
+    //   - it is held exclusively by anything that changes the friend graph, posts, users or
+    //     credentials, by compaction and by reload.
+    //   - friend requests and privacy changes only need a shared shard: friendRequests has its own
+    //     requestMutex, privacy is an atomic flag, and the journal takes concurrent appends.
+    // The private helpers below expect the caller to hold the lock they need.
+    Journal journal;
+    mutable ShardedSharedMutex stateLock;
+    mutable std::mutex requestMutex;
+    size_t postsOnDisk = 0; // rows below this are already in Posts.txt
+    std::atomic<bool> usersDirty{false};
+    std::atomic<bool> friendsDirty{false};
+    std::atomic<bool> requestsDirty{false};
+    // FriendRequests.txt already holds the first requestsFoldedRecords records of this journal
+    // generation, when a compaction died before it could truncate the journal.
+    uint64_t requestsFoldedGeneration = 0;
+    size_t requestsFoldedRecords = 0;
+    std::thread compactionThread;
+    std::mutex compactionMutex;
+    std::condition_variable compactionWake;
+    bool stopCompaction = false;
+    std::unique_ptr<MetricsExporter> metricsExporter; // only created when options.metricsFile is set
 
-    User* idToPointer(std::string userId) const;
-    User* usernameToPointer(const std::string& username) const;
-    void saveAllFriendsToFile();
+    User* idToPointer(std::string_view userId) const;
+    bool saveAllUsersToFile();
+    bool saveAllFriendsToFile();
+    bool saveAllRequestsToFile();
+    void loadAllData();
+    bool snapshotIsFresh() const;
+    bool loadSnapshot();
+    void sortAllPostsByTime();
+    void indexAllPosts();
+    void addFriendship(User* user, User* newFriend, bool logToJournal);
+    void removeFriendship(User* user, User* exFriend, bool logToJournal);
+    bool addRequest(User* from, User* to, long long timestamp, bool logToJournal);
+    bool resolveRequest(User* from, User* to, bool accepted, bool logToJournal);
+    void upgradeCredential(User* user, Credential credential, bool logToJournal);
+    void applyPrivacy(User* user, bool isPublic, bool logToJournal);
+    void replayJournal();
+    void replayJournalRecord(std::string_view record, bool requestsFolded);
+    void compactionLoop();
+    User* promptForUser(const std::string& prompt);
+    void handleLogin();
+    void handleSignUp();
+    void handleViewFeed();
+    void handleViewProfile();
     void handleSendRequest();
+    void handlePeopleYouMayKnow();
+    void handleFindConnection();
     void handleRespondRequests();
     void handleRemoveFriend();
+    void handleSearchPosts();
 
 public:
-    FakeBook();
+    explicit FakeBook(FakeBookOptions options = {});
+    ~FakeBook();
     void runFakeBook();
     void parseAllUsers();
     void parseAllFriends();
     void parseAllPosts();
-    void appendFriend();
-    void appendPost(Post *newPost);
+    void parseAllRequests();
+    void compactJournal();
+    void saveSnapshot();
+    // Every user's recommendFriends() as userId:recommendedId/mutualFriends,... lines, ranked on
+    // the ingest pool. False when 'path' couldn't be written.
+    bool saveRecommendations(const std::string& path, size_t limit);
+    void shutdown(); // what Quit does: fold the journal in and refresh the snapshot
+
+    /* The operations behind the menu, for the menu itself, BatchRunner and SessionServer. They
+       neither prompt nor print; a null or false result is the reason's only report. Each takes
+       the locks it needs, so any number of sessions may call them from different threads. */
+    User* usernameToPointer(std::string_view username) const;
+    // Usernames starting with, or a typo or two away from, 'typed', best first; see UsernameIndex.
+    std::vector<UsernameMatch> suggestUsernames(const User* viewer, std::string_view typed, size_t limit) const;
+    // 'busy' when maxQueuedLogins logins are already waiting to be hashed; try again later.
+    LoginResult login(std::string email, std::string password);
+    User* signUp(const SignUpForm& form);
+    uint32_t createPost(User* author, const PostDraft& draft); // the new PostStore row, or NO_POST
+    RequestOutcome sendRequest(User* from, User* to);
+    std::vector<User*> pendingRequestsTo(const User* user) const;
+    bool respondToRequest(User* user, User* sender, bool accept); // false when no request was pending
+    bool removeFriend(User* user, User* exFriend);                // false when they weren't friends
+    FeedPage getFeed(User* user, size_t limit, const FeedCursor& cursor = {});
+    ProfileView viewProfile(const User* viewer, const User* target) const;
+    // Posts matching every word and "quoted phrase" of 'query' that 'viewer' may see, most
+    // recently loaded first; see PostIndex::search.
+    SearchPage searchPosts(const User* viewer, std::string_view query, size_t limit, uint32_t before = UINT32_MAX) const;
+    // Friends of the user's friends they may know, best first; see FriendRecommender.
+    std::vector<Recommendation> recommendFriends(const User* user, size_t limit) const;
+    // A shortest chain of friends from 'user' to 'target', and their mutual friends; see ConnectionFinder.
+    Connection findConnection(const User* user, const User* target) const;
+    // Degree, component, clustering and activity statistics of the whole friend graph, computed
+    // on the ingest pool; see GraphAnalytics.
+    GraphReport analyzeGraph() const;
+    void setPrivacy(User* user, bool isPublic);
+    // PostStore rows as postId#author#content lines, each after 'linePrefix'. The store may grow
+    // under other sessions, so rows are only read through this while they hold no lock.
+    void writePosts(std::ostream& out, std::string_view linePrefix, const std::vector<uint32_t>& rows) const;
+    const FakeBookOptions& getOptions() const {
+        return options;
+    }
 };
 #endif //FAKEBOOK_H
\ No newline at end of file
@@ -0,0 +1,112 @@
+#ifndef FRIENDGRAPH_H
+#define FRIENDGRAPH_H
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+class User;
+
+/* Friend lists of every user in compressed sparse row form: node i's friends are
+   neighbours[offsets[i] .. offsets[i + 1]), sorted 32-bit node indices, so walking a friend list
+   is a linear scan of one array and membership is a binary search. High-degree rows also get a
+   bitset over all nodes for O(1) membership.
+
+   Edits don't touch the arrays. They go into a small sorted per-node overlay (friends added,
+   base friends removed) that readers consult alongside the base row, and the overlays are merged
+   back into a fresh CSR once they grow past a fraction of the edge count.
+
+   Edges are directed like the old per-user lists; FakeBook adds and removes both directions. */
+class FriendGraph {
+private:
+    struct Overlay {
+        std::vector<uint32_t> added;   // not in the base row, sorted
+        std::vector<uint32_t> removed; // in the base row, sorted
+    };
+
+    std::vector<User*> nodes;
+    std::vector<uint64_t> offsets{0};
+    std::vector<uint32_t> neighbours;
+    std::vector<int32_t> bitsetSlot; // per node, -1 when the row has no bitset
+    std::vector<std::vector<uint64_t>> bitsets;
+    std::unordered_map<uint32_t, Overlay> overlays;
+    size_t overlayEntries = 0;
+
+    bool inBaseRow(uint32_t from, uint32_t to) const;
+    void buildBitsets();
+    void mergeIfLarge();
+public:
+    // Friends of one node as User*, base row (minus removals) first, then additions.
+    class FriendRange {
+    public:
+        class iterator {
+        private:
+            const uint32_t* base;
+            const uint32_t* baseEnd;
+            const uint32_t* removed;
+            const uint32_t* removedEnd;
+            const uint32_t* added;
+            User* const* nodes;
+
+            void skipRemoved() {
+                while (base != baseEnd && removed != removedEnd && *removed <= *base) {
+                    if (*removed == *base)
+                        ++base;
+                    ++removed;
+                }
+            }
+        public:
+            iterator(const uint32_t* _base, const uint32_t* _baseEnd, const uint32_t* _removed,
+                     const uint32_t* _removedEnd, const uint32_t* _added, User* const* _nodes)
+                : base(_base), baseEnd(_baseEnd), removed(_removed), removedEnd(_removedEnd), added(_added), nodes(_nodes) {
+                skipRemoved();
+            }
+            User* operator*() const { return nodes[base != baseEnd ? *base : *added]; }
+            iterator& operator++() {
+                if (base != baseEnd) {
+                    ++base;
+                    skipRemoved();
+                } else {
+                    ++added;
+                }
+                return *this;
+            }
+            bool operator==(const iterator& other) const { return base == other.base && added == other.added; }
+            bool operator!=(const iterator& other) const { return !(*this == other); }
+        };
+
+        FriendRange(iterator _first, iterator _last, size_t _count) : first(_first), last(_last), count(_count) {}
+        iterator begin() const { return first; }
+        iterator end() const { return last; }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+    private:
+        iterator first;
+        iterator last;
+        size_t count;
+    };
+
+    // Appends a node with no friends and tells the user its index.
+    uint32_t addNode(User* user);
+    // Replaces every edge. Rows are sorted and deduplicated; offsets must have nodeCount() + 1 entries.
+    void assign(std::vector<uint64_t> rowOffsets, std::vector<uint32_t> rowNeighbours);
+    void assignEdges(const std::vector<std::pair<uint32_t, uint32_t>>& edges);
+    void clear();
+    size_t nodeCount() const { return nodes.size(); }
+    User* nodeAt(uint32_t node) const { return nodes[node]; }
+    size_t edgeCount() const;
+
+    bool addEdge(uint32_t from, uint32_t to);
+    bool removeEdge(uint32_t from, uint32_t to);
+    bool hasEdge(uint32_t from, uint32_t to) const;
+    size_t degree(uint32_t node) const;
+    FriendRange friendsOf(uint32_t node) const;
+    // The node's friends as sorted indices: its base row, or a merged copy in 'scratch' when it
+    // has an overlay.
+    std::pair<const uint32_t*, const uint32_t*> sortedRow(uint32_t node, std::vector<uint32_t>& scratch) const;
+    // Friends 'a' and 'b' have in common.
+    size_t commonNeighbourCount(uint32_t a, uint32_t b) const;
+    std::vector<uint32_t> commonNeighbours(uint32_t a, uint32_t b) const; // sorted
+    void mergeOverlays();
+};
+#endif //FRIENDGRAPH_H
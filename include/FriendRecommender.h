@@ -0,0 +1,51 @@
+#ifndef FRIENDRECOMMENDER_H
+#define FRIENDRECOMMENDER_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+class FriendGraph;
+class User;
+
+struct Recommendation {
+    User* user = nullptr;
+    uint32_t mutualFriends = 0;
+    bool sameLocation = false;
+    bool closeInAge = false;
+    uint32_t score = 0;
+};
+
+// What a candidate's score is made of; a weight of 0 turns that part off.
+struct RecommendationWeights {
+    uint32_t perMutualFriend = 2;
+    uint32_t sameLocation = 1; // lives where the user does
+    uint32_t closeInAge = 1;   // at most ageBand years apart
+    int ageBand = 5;
+};
+
+/* "People you may know": the friends of a user's friends who aren't their friends yet, ranked by
+   score, then by graph index.
+
+   One pass over the friends' sorted rows counts every candidate's mutual friends into a per-thread
+   array indexed by graph node, so a query costs the sum of its friends' degrees and allocates
+   nothing once warm. Friends with more than hubDegree friends are only expanded when the others
+   don't yield a full page: sharing a celebrity says little, and their rows would dominate the
+   cost. The page's mutual friend counts are then made exact, hubs included, by intersecting
+   sorted rows. Each node's location and age are copied into one dense array, so ranking the
+   thousands of candidates of a typical query doesn't read their User objects.
+
+   Queries only read; callers hold FakeBook's stateLock shared, so any number of threads may
+   query at once. */
+class FriendRecommender {
+private:
+    const FriendGraph& graph;
+    size_t hubDegree;
+    std::vector<uint64_t> profiles; // per graph node: location key << 32 | age
+public:
+    FriendRecommender(const FriendGraph& _graph, size_t _hubDegree);
+    // Call right after FriendGraph::addNode, so profiles stay in graph order.
+    void addUser(const User* user);
+    void clear();
+    // At most 'limit' recommendations for 'user', best first.
+    std::vector<Recommendation> recommend(const User* user, size_t limit, const RecommendationWeights& weights) const;
+};
+#endif //FRIENDRECOMMENDER_H
@@ -0,0 +1,59 @@
+#ifndef FRIENDREQUESTSTORE_H
+#define FRIENDREQUESTSTORE_H
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+class User;
+class IdGenerator;
+
+enum class RequestStatus { Pending, Accepted, Declined };
+
+const char* requestStatusName(RequestStatus status);
+bool parseRequestStatus(std::string_view text, RequestStatus& status);
+
+// One line of FriendRequests.txt: fromUserId#toUserId#timestamp#status. The ID is handed out
+// when the request enters the store and is not persisted.
+struct FriendRequest {
+    uint64_t id;
+    User* from;
+    User* to;
+    long long timestamp;
+    RequestStatus status;
+};
+
+/* In-memory friend requests, loaded once from FriendRequests.txt and kept up to date through the
+   journal. Pending requests are indexed by (from, to) pair, so duplicate and reverse-request
+   checks are O(1), and per recipient/sender, so listing an inbox is O(inbox size).
+   Requests only move Pending -> Accepted or Pending -> Declined. */
+class FriendRequestStore {
+private:
+    struct PairHash {
+        size_t operator()(const std::pair<const User*, const User*>& key) const {
+            size_t first = std::hash<const User*>{}(key.first);
+            return first ^ (std::hash<const User*>{}(key.second) + 0x9e3779b97f4a7c15ULL + (first << 6) + (first >> 2));
+        }
+    };
+
+    IdGenerator& ids;
+    std::vector<FriendRequest> requests; // every request ever loaded or sent, in arrival (and so ID) order
+    std::unordered_map<std::pair<const User*, const User*>, size_t, PairHash> pendingByPair;
+    std::unordered_map<const User*, std::vector<size_t>> inbox;  // pending requests per recipient
+    std::unordered_map<const User*, std::vector<size_t>> outbox; // pending requests per sender
+
+    static void unlink(std::vector<size_t>& list, size_t index);
+public:
+    explicit FriendRequestStore(IdGenerator& _ids);
+
+    bool add(User* from, User* to, long long timestamp, RequestStatus status = RequestStatus::Pending);
+    bool resolve(const User* from, const User* to, RequestStatus newStatus);
+    bool hasPending(const User* from, const User* to) const;
+    std::vector<User*> pendingSendersTo(const User* to) const;
+    std::vector<User*> pendingRecipientsFrom(const User* from) const;
+    const FriendRequest* find(uint64_t id) const;
+    const std::vector<FriendRequest>& all() const { return requests; }
+    void clear();
+};
+#endif //FRIENDREQUESTSTORE_H
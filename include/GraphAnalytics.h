@@ -0,0 +1,72 @@
+#ifndef GRAPHANALYTICS_H
+#define GRAPHANALYTICS_H
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+class FriendGraph;
+class ThreadPool;
+
+// What GraphAnalytics::run found; writeJson() is the report.
+struct GraphReport {
+    static constexpr size_t EXAMPLE_IDS = 100;      // user IDs listed per group without friends or posts
+    static constexpr size_t LARGEST_COMPONENTS = 10;
+
+    unsigned threads = 1;
+    uint64_t users = 0;
+    uint64_t links = 0; // friend list entries; every friendship is two
+
+    uint32_t minDegree = 0;
+    uint32_t maxDegree = 0;
+    double meanDegree = 0;
+    uint32_t degreeP50 = 0;
+    uint32_t degreeP90 = 0;
+    uint32_t degreeP99 = 0;
+    std::vector<uint64_t> degreeBuckets; // [0] users with no friends, [i] those with 2^(i-1) to 2^i - 1
+
+    uint64_t components = 0;
+    std::vector<uint64_t> largestComponents; // sizes, largest first
+
+    uint64_t triangles = 0;
+    double transitivity = 0;      // 3 * triangles / pairs of friends sharing a user
+    double averageClustering = 0; // mean local clustering coefficient of the users with 2+ friends
+
+    uint64_t usersWithoutFriends = 0;
+    uint64_t usersWithoutPosts = 0;
+    std::vector<std::string> withoutFriendsExamples;
+    std::vector<std::string> withoutPostsExamples;
+
+    double degreeSeconds = 0;
+    double componentSeconds = 0;
+    double triangleSeconds = 0;
+
+    void writeJson(std::ostream& out) const;
+};
+
+/* Whole-graph statistics for offline reports. Each pass runs over slices of graph nodes on a
+   ThreadPool, or serially without one:
+     - degrees: read per node, then percentiles by nth_element.
+     - connected components: lock-free union-find. Every friendship unites its two ends' roots
+       with a compare-and-swap that links the higher root under the lower, so no cycle can form,
+       and finds halve their path as they go.
+     - triangles: friendships are oriented from the lower (degree, index) end to the higher, so
+       each triangle is found once, from its lowest corner, by merging two oriented rows, and no
+       oriented row is much longer than the square root of the friendship count. Per-user
+       triangle counts, for the local clustering coefficients, are relaxed atomic increments.
+   Reads the graph as it is; callers hold FakeBook's stateLock shared. */
+class GraphAnalytics {
+private:
+    const FriendGraph& graph;
+    ThreadPool* pool;
+
+    template <typename Work>
+    void forEachSlice(size_t count, const Work& work) const;
+    void countDegrees(GraphReport& report) const;
+    void findComponents(GraphReport& report) const;
+    void countTriangles(GraphReport& report) const;
+public:
+    GraphAnalytics(const FriendGraph& _graph, ThreadPool* _pool);
+    GraphReport run() const;
+};
+#endif //GRAPHANALYTICS_H
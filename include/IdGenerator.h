@@ -0,0 +1,37 @@
+#ifndef IDGENERATOR_H
+#define IDGENERATOR_H
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/* Snowflake-style 64-bit IDs for users, posts and friend requests:
+
+     | 41 bits: milliseconds since ID_EPOCH | 10 bits: worker | 12 bits: sequence |
+
+   IDs from one generator strictly increase, so they sort by creation time, and generators with
+   different worker numbers never collide. next() is lock-free: the last ID handed out is a single
+   atomic advanced with compare-and-swap. Past 4096 IDs in one millisecond the generator borrows
+   the next millisecond instead of waiting, and a clock that steps backwards never makes an ID
+   go backwards. */
+class IdGenerator {
+public:
+    static constexpr unsigned WORKER_BITS = 10;
+    static constexpr unsigned SEQUENCE_BITS = 12;
+    static constexpr uint32_t MAX_WORKER = (1u << WORKER_BITS) - 1;
+    static constexpr long long ID_EPOCH_MS = 1704067200000LL; // 2024-01-01T00:00:00Z
+private:
+    static constexpr uint64_t SEQUENCE_MASK = (uint64_t{1} << SEQUENCE_BITS) - 1;
+    static constexpr unsigned TIMESTAMP_SHIFT = WORKER_BITS + SEQUENCE_BITS;
+
+    uint64_t workerBits;
+    std::atomic<uint64_t> last; // always carries this worker's bits
+public:
+    explicit IdGenerator(uint32_t workerId = 0);
+    IdGenerator(const IdGenerator&) = delete;
+    IdGenerator& operator=(const IdGenerator&) = delete;
+
+    uint64_t next();
+    static uint32_t workerOf(uint64_t id) { return static_cast<uint32_t>(id >> SEQUENCE_BITS) & MAX_WORKER; }
+    static std::chrono::system_clock::time_point timeOf(uint64_t id);
+};
+#endif //IDGENERATOR_H
@@ -0,0 +1,46 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/* Append-only mutation log in DataStorage. Each record is one '#'-separated line:
+       FRIEND_ADD#userId#friendId
+       FRIEND_REMOVE#userId#friendId
+       REQUEST#fromUserId#toUserId#timestamp
+       RESOLVE#fromUserId#toUserId#ACCEPTED|DECLINED
+       POST#<a Posts.txt line>
+       CREDENTIAL#userId#<stored credential>
+       PRIVACY#userId#Public|Private
+   Records are replayed over the base files on startup and folded back into them by compaction,
+   after which the log is truncated. A torn last line (crash mid-write) is ignored on replay.
+   The first line, GENERATION#n, is not a record: it names this incarnation of the log, and every
+   truncate starts a new one, so a base file can say which records it already holds.
+   append() may be called from several threads at once; replay() and truncate() may not. A
+   read-only journal is never created or written: it can be replayed, and append() and truncate()
+   fail. */
+class Journal {
+private:
+    std::string path;
+    int fd = -1;
+    std::atomic<size_t> recordCount{0};
+    uint64_t generation = 0; // 0 for a log written before generations existed
+
+    bool writeLine(std::string_view line);
+    bool startGeneration();
+public:
+    explicit Journal(std::string _path, bool readOnly = false);
+    ~Journal();
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    bool append(std::string_view record);
+    size_t size() const { return recordCount; }
+    uint64_t getGeneration() const { return generation; }
+    size_t replay(const std::function<void(std::string_view record)>& apply);
+    bool truncate();
+};
+#endif //JOURNAL_H
@@ -0,0 +1,27 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole DataStorage file. The parsers split lines and fields
+// straight out of the mapping as string_views instead of copying them through streams.
+class MappedFile {
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+    int fd = -1;
+
+    void release();
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool isOpen() const { return fd != -1; }
+    std::string_view view() const { return {data, length}; }
+};
+#endif //MAPPEDFILE_H
@@ -0,0 +1,119 @@
+#ifndef METRICS_H
+#define METRICS_H
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Timed operations. Each has a latency histogram, see Metrics.
+enum class Timer {
+    ParseUsers, ParseFriends, ParsePosts, ParseRequests, LoadSnapshot, ReplayJournal,
+    FeedQuery, FeedBuild, CreatePost, Login, PasswordHash,
+    SaveUsers, SaveFriends, SaveRequests, SaveSnapshot, Compaction,
+    IndexPosts, SearchPosts, IndexUsernames, SuggestUsernames,
+    RecommendFriends, SaveRecommendations, FindConnection,
+    Count
+};
+
+enum class Counter {
+    LoginSucceeded, LoginFailed, LoginBusy, PostsCreated, FeedPostsServed, JournalRecords,
+    Count
+};
+
+constexpr size_t TIMER_COUNT = static_cast<size_t>(Timer::Count);
+constexpr size_t COUNTER_COUNT = static_cast<size_t>(Counter::Count);
+
+/* Process-wide hot-path instrumentation: counters and per-operation latency histograms.
+
+   Histograms are HDR-style: values below 16 ns get a bucket each, above that every power of two
+   is split into 16 buckets, so any recorded latency is off by at most 1/16. Every thread records
+   into its own block of buckets, with plain relaxed loads and stores since it is the block's only
+   writer; snapshot() sums the blocks. Blocks are registered once per thread and kept until exit.
+
+   Everything is off until setEnabled(true). While off, a ScopedTimer costs one relaxed load and
+   a branch, and count() the same. */
+class Metrics {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 4;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t{1} << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_EXPONENT = 44; // ~4.9 hours in ns; anything longer lands in the last bucket
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    struct Histogram {
+        std::array<uint64_t, BUCKET_COUNT> buckets{};
+        uint64_t count = 0;
+        uint64_t sumNanos = 0;
+
+        // Smallest value that lands in bucket 'index'.
+        static uint64_t lowerBound(size_t index);
+        // Upper edge of the bucket holding the 'fraction' quantile, 0 when empty.
+        uint64_t quantile(double fraction) const;
+    };
+    struct Snapshot {
+        std::array<Histogram, TIMER_COUNT> timers{};
+        std::array<uint64_t, COUNTER_COUNT> counters{};
+    };
+
+    static void setEnabled(bool on) { enabledFlag.store(on, std::memory_order_relaxed); }
+    static bool enabled() { return enabledFlag.load(std::memory_order_relaxed); }
+    static size_t bucketOf(uint64_t nanos);
+    static void record(Timer timer, uint64_t nanos);
+    static void count(Counter counter, uint64_t amount = 1) {
+        if (enabled())
+            addToCounter(counter, amount);
+    }
+    static Snapshot snapshot();
+    static const char* name(Timer timer);
+    static const char* name(Counter counter);
+    // Prometheus text exposition format, written to a temporary file and renamed over 'path' so
+    // a scraper never reads half a dump.
+    static bool writePrometheus(const std::string& path);
+private:
+    static std::atomic<bool> enabledFlag;
+    static void addToCounter(Counter counter, uint64_t amount);
+};
+
+// Times its scope into 'timer', if metrics were enabled when it started.
+class ScopedTimer {
+private:
+    Timer timer;
+    bool active;
+    std::chrono::steady_clock::time_point start;
+public:
+    explicit ScopedTimer(Timer _timer) : timer(_timer), active(Metrics::enabled()) {
+        if (active)
+            start = std::chrono::steady_clock::now();
+    }
+    ~ScopedTimer() {
+        if (active) {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            Metrics::record(timer, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+// Dumps Metrics to 'path' every 'intervalSeconds' on its own thread, and once more when destroyed.
+class MetricsExporter {
+private:
+    std::string path;
+    unsigned intervalSeconds;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread worker;
+
+    void exportLoop();
+public:
+    MetricsExporter(std::string _path, unsigned _intervalSeconds);
+    ~MetricsExporter();
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+};
+#endif //METRICS_H
@@ -1,22 +1,27 @@
 #ifndef POST_H
 #define POST_H
 #include <chrono>
+#include <ostream>
+#include <cstdint>
+#include <string_view>
+#include "PostStore.h"
 class User;
 
+// Read-only view of one PostStore row. Cheap to copy; valid as long as the store is not cleared.
 class Post {
 private:
-    std::string postId;
-    User* authorId;
-    std::string content;
-    bool isPublicPost;
-    std::chrono::system_clock::time_point timeUploaded;
+    const PostStore* store;
+    uint32_t row;
 public:
-    Post(User* author, std::string _content, std::chrono::system_clock::time_point timeStamp, bool _isPublic, std::string postId);
-    void displayPost();
-    std::string getPostId() const { return postId; }
-    User* getAuthor() const { return authorId; }
-    std::string getContent() const { return content; }
-    bool isPublic() const { return isPublicPost; }
-    std::chrono::system_clock::time_point getTimestamp() const { return timeUploaded; }
+    Post(const PostStore& _store, uint32_t _row) : store(&_store), row(_row) {}
+    void displayPost() const;
+    uint32_t getRow() const { return row; }
+    std::string_view getPostId() const { return store->postId(row); }
+    User* getAuthor() const { return store->author(row); }
+    std::string_view getContent() const { return store->content(row); }
+    bool isPublic() const { return store->isPublic(row); }
+    std::chrono::system_clock::time_point getTimestamp() const { return store->timestamp(row); }
+    // Posts.txt line without the newline: postId#authorId#content#timestamp#visibility
+    void writeLine(std::ostream& out) const;
 };
 #endif //POST_H
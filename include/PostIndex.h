@@ -0,0 +1,104 @@
+#ifndef POSTINDEX_H
+#define POSTINDEX_H
+#include <cstddef>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "StringPool.h"
+class PostStore;
+class ThreadPool;
+
+// One page of search results, most recently loaded post first. Pass 'next' as the next call's
+// 'before' to continue.
+struct SearchPage {
+    std::vector<uint32_t> posts;
+    uint32_t next = 0;
+    bool hasMore = false;
+};
+
+/* Inverted index over post content: for every word, the PostStore rows containing it and the
+   word's positions in each, so queries can match phrases.
+
+   Words are runs of letters and digits, lowercased; bytes outside ASCII count as letters, so
+   other scripts are indexed as written. A word's postings are kept compressed, in blocks of up to
+   BLOCK_POSTINGS: every posting is a varint row delta, a varint position count and varint
+   position deltas. Each block records its first and last row and byte offset, so a query can skip
+   to the block holding a row, and decodes one block at a time.
+
+   build() indexes a whole store, chunk by chunk on the ingest pool, then merges the chunks one
+   term shard per task. add() indexes one new post,
+   which must have a higher row than anything indexed before, as PostStore::append guarantees.
+   Not thread-safe; FakeBook's stateLock guards it like the PostStore. */
+class PostIndex {
+public:
+    static constexpr size_t BLOCK_POSTINGS = 128;
+
+    struct Block {
+        uint32_t firstRow;
+        uint32_t lastRow;
+        uint32_t count;
+        uint64_t offset; // into PostingList::bytes
+    };
+    struct PostingList {
+        std::vector<uint8_t> bytes;
+        std::vector<Block> blocks;
+        uint64_t postings = 0;
+
+        void add(uint32_t row, const std::vector<uint32_t>& positions);
+        // Appends 'later', whose rows all come after this list's; its blocks are kept as they are.
+        void append(const PostingList& later);
+    };
+    // Words are spread over TERM_SHARDS dictionaries by hash, so build() can merge its chunks
+    // into every shard at once.
+    static constexpr size_t TERM_SHARDS = 16;
+    struct TermShard {
+        StringPool terms;                  // word -> term key
+        std::vector<PostingList> postings; // by term key
+    };
+    using TermShards = std::array<TermShard, TERM_SHARDS>;
+private:
+    TermShards shards;
+
+    const PostingList* find(std::string_view word) const;
+public:
+    static constexpr size_t MAX_WORD_BYTES = 64; // longer words are indexed by their first 64 bytes
+
+    // Calls 'visit(word, position)' for every word of 'text'; 'word' is lowercased and only valid
+    // during the call.
+    template <typename Visit>
+    static void forEachWord(std::string_view text, Visit&& visit) {
+        char word[MAX_WORD_BYTES];
+        size_t length = 0;
+        uint32_t position = 0;
+        for (size_t i = 0; i <= text.size(); ++i) {
+            unsigned char c = i < text.size() ? static_cast<unsigned char>(text[i]) : ' ';
+            bool isWordByte = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+            if (isWordByte) {
+                if (length < MAX_WORD_BYTES)
+                    word[length++] = static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+            } else if (length > 0) {
+                visit(std::string_view(word, length), position++);
+                length = 0;
+            }
+        }
+    }
+
+    void build(const PostStore& store, ThreadPool* pool);
+    void add(uint32_t row, std::string_view content);
+    void clear();
+    static size_t shardOf(std::string_view word);
+    size_t termCount() const;
+    size_t compressedBytes() const;
+
+    /* Rows below 'before' that match every part of 'query' and pass 'visible', highest row first,
+       at most 'limit' of them. A part is a word, a "quoted phrase", or a word with punctuation in
+       it such as no.12, which must match as the phrase "no 12". Rows follow load order, not
+       timestamps: loaded posts come in file order, which is grouped by author, and posts created
+       since come after them. So results are most recently loaded first, not newest first. */
+    SearchPage search(std::string_view query, size_t limit, uint32_t before,
+                      const std::function<bool(uint32_t row)>& visible) const;
+};
+#endif //POSTINDEX_H
@@ -0,0 +1,82 @@
+#ifndef POSTSTORE_H
+#define POSTSTORE_H
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "FriendGraph.h"
+#include "StringPool.h"
+class User;
+class Post;
+
+/* Every post, stored column by column. A post is a row number: rows are handed out in append
+   order and never change, so users, feed buffers and pages keep plain uint32_t rows and read
+   only the columns they need, e.g. a feed merge touches the timestamp column and nothing else
+   until two posts tie.
+
+     times      system_clock ticks of each post
+     authors    the author's friend graph index, resolved to a User* through the graph
+     postKeys   the external post ID, as a key into 'ids'
+     publicBits visibility bitmap, bit set = public
+     content    offsets into the borrowed text, then into one text buffer; contentOffsets has
+                size() + 1 entries
+
+   Post is a read-only view of one row for code that wants a whole post. Views returned by
+   content() and Post::getContent() are invalidated by the next append(). Not thread-safe. */
+class PostStore {
+public:
+    using Ticks = std::chrono::system_clock::rep;
+private:
+    const FriendGraph* graph;
+    StringPool ids;
+    std::vector<Ticks> times;
+    std::vector<uint32_t> authors;
+    std::vector<uint32_t> postKeys;
+    std::vector<uint64_t> publicBits;
+    std::vector<uint64_t> contentOffsets{0};
+    std::string_view borrowedText; // the first rows' content, e.g. in a mapped snapshot
+    std::string contentText;
+public:
+    explicit PostStore(const FriendGraph& _graph);
+
+    uint32_t append(const User* author, std::string_view postId, std::string_view content,
+                    std::chrono::system_clock::time_point timeStamp, bool isPublic);
+    /* For an empty store loaded from a mapping: 'text' is the content of the rows about to be
+       appended, back to back in row order, and post IDs inside 'idText' are interned without a
+       copy. append() then takes those rows' content as a view and only records its length. Both
+       have to outlive the store or its next clear(). */
+    void borrow(std::string_view text, std::string_view idText);
+    void reserve(size_t posts, size_t contentBytes);
+    void clear();
+    size_t size() const { return times.size(); }
+    bool containsPostId(std::string_view postId) const { return ids.find(postId) != StringPool::NOT_FOUND; }
+
+    Ticks ticks(uint32_t row) const { return times[row]; }
+    std::chrono::system_clock::time_point timestamp(uint32_t row) const {
+        return std::chrono::system_clock::time_point(std::chrono::system_clock::duration(times[row]));
+    }
+    uint32_t authorIndex(uint32_t row) const { return authors[row]; }
+    User* author(uint32_t row) const { return graph->nodeAt(authors[row]); }
+    std::string_view postId(uint32_t row) const { return ids.view(postKeys[row]); }
+    bool isPublic(uint32_t row) const { return (publicBits[row / 64] >> (row % 64)) & 1; }
+    std::string_view content(uint32_t row) const {
+        uint64_t begin = contentOffsets[row], length = contentOffsets[row + 1] - begin;
+        if (begin < borrowedText.size())
+            return borrowedText.substr(begin, length);
+        return std::string_view(contentText).substr(begin - borrowedText.size(), length);
+    }
+    Post at(uint32_t row) const;
+
+    // Feed order: newest first, ties broken by row, i.e. by load order, which is stable across runs.
+    bool isNewer(uint32_t a, uint32_t b) const {
+        return times[a] != times[b] ? times[a] > times[b] : a < b;
+    }
+    bool isOlder(uint32_t a, uint32_t b) const { return isNewer(b, a); }
+
+    // Copies to 'out' the rows of 'rows' posted no later than 'until' and, if publicOnly, public;
+    // returns how many. 'out' needs room for 'count' rows and may alias 'rows'.
+    size_t filter(const uint32_t* rows, size_t count, Ticks until, bool publicOnly, uint32_t* out) const;
+};
+#endif //POSTSTORE_H
@@ -0,0 +1,56 @@
+#ifndef SESSIONSERVER_H
+#define SESSIONSERVER_H
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include "BatchRunner.h"
+#include "ThreadPool.h"
+class FakeBook;
+
+/* Serves many sessions at once over one multiplexed stream, e.g. stdin. Every input line is
+
+       <session>#<command>
+
+   where <session> is any name the client picks and <command> is a BatchRunner script line. Each
+   session has its own login and feed cursor. Commands of one session run in order, one pool task
+   per command so a busy session can't starve the others; different sessions run concurrently.
+   Replies are written whole, so lines of different sessions never interleave:
+
+       <session>#OK#<COMMAND>      then <session>#POST#postId#author#content per post shown
+       <session>#FAIL#<COMMAND>    FakeBook refused it
+       <session>#BUSY#<COMMAND>    a LOGIN turned away while too many are being hashed; retry later
+       <session>#ERROR#<line>      not a command, or the session isn't logged in */
+class SessionServer {
+private:
+    struct Session {
+        CommandSession state;
+        std::deque<std::string> pending;
+        bool scheduled = false; // a pool task owns the front of 'pending'
+    };
+
+    FakeBook& fakebook;
+    std::mutex sessionsMutex;
+    std::condition_variable allIdle;
+    std::unordered_map<std::string, Session> sessions;
+    size_t scheduledSessions = 0;
+    std::mutex outputMutex;
+    std::ostream* out = nullptr;
+    std::atomic<size_t> commandsRun{0};
+    ThreadPool workers; // last, so it is joined before the state its tasks use goes away
+
+    void runNext(const std::string& name, Session& session);
+    void reply(const std::string& text);
+public:
+    SessionServer(FakeBook& _fakebook, unsigned threads);
+    // Returns once 'in' is exhausted and every command read from it has run.
+    void serve(std::istream& in, std::ostream& _out);
+    size_t sessionCount() const { return sessions.size(); }
+    size_t commandCount() const { return commandsRun.load(); }
+};
+#endif //SESSIONSERVER_H
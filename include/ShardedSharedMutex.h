@@ -0,0 +1,59 @@
+#ifndef SHARDEDSHAREDMUTEX_H
+#define SHARDEDSHAREDMUTEX_H
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <shared_mutex>
+#include <thread>
+
+/* A reader-writer lock split into SHARDS shared_mutexes, each on its own cache line. A reader
+   takes one shard, normally the one of the user it reads for, so readers of different users never
+   write to a common cache line. A writer takes every shard, in order. Writes cost SHARDS lock
+   operations instead of one; in exchange reads scale with cores instead of queueing on a single
+   reader count. */
+class ShardedSharedMutex {
+public:
+    static constexpr size_t SHARDS = 64;
+private:
+    struct alignas(64) Shard {
+        std::shared_mutex mutex;
+    };
+    std::array<Shard, SHARDS> shards;
+public:
+    // lock() and unlock() make this BasicLockable, so std::lock_guard works for the write side.
+    void lock() {
+        for (Shard& shard : shards)
+            shard.mutex.lock();
+    }
+    void unlock() {
+        for (auto it = shards.rbegin(); it != shards.rend(); ++it)
+            it->mutex.unlock();
+    }
+    void lockShared(size_t key) {
+        shards[key % SHARDS].mutex.lock_shared();
+    }
+    void unlockShared(size_t key) {
+        shards[key % SHARDS].mutex.unlock_shared();
+    }
+    // Shard key for reads that aren't on behalf of one user.
+    static size_t threadKey() {
+        return std::hash<std::thread::id>{}(std::this_thread::get_id());
+    }
+};
+
+// Holds one shard of a ShardedSharedMutex for reading. Any single shard keeps writers out.
+class SharedShardLock {
+private:
+    ShardedSharedMutex& mutex;
+    size_t key;
+public:
+    SharedShardLock(ShardedSharedMutex& _mutex, size_t _key) : mutex(_mutex), key(_key) {
+        mutex.lockShared(key);
+    }
+    ~SharedShardLock() {
+        mutex.unlockShared(key);
+    }
+    SharedShardLock(const SharedShardLock&) = delete;
+    SharedShardLock& operator=(const SharedShardLock&) = delete;
+};
+#endif //SHARDEDSHAREDMUTEX_H
@@ -0,0 +1,101 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "MappedFile.h"
+class User;
+class PostStore;
+
+/* Binary image of the loaded state, so a restart doesn't have to re-parse the text files and
+   re-resolve every string ID. Layout (native endianness, every section 8-byte aligned):
+       SnapshotHeader
+       SnapshotUser[userCount]
+       uint64_t friendOffsets[userCount + 1]   CSR row offsets into friendIndices
+       uint32_t friendIndices[edgeCount]       indices into the user table
+       SnapshotPost[postCount]
+       char strings[stringBytes]               every user's strings, every post ID, then every
+                                               post's content back to back in row order
+   The loader keeps the mapping open and uses the strings in place, so the text files stay the
+   import/export format and the snapshot only a cache of them. */
+
+const uint32_t SNAPSHOT_VERSION = 2;
+
+// A user's strings are stored back to back at textOffset, in declaration order.
+struct SnapshotUser {
+    uint64_t textOffset;
+    uint32_t userIdLength;
+    uint32_t userNameLength;
+    uint32_t emailLength;
+    uint32_t passwordLength;
+    uint32_t locationLength;
+    int32_t age;
+    int64_t createdAt; // seconds since epoch, like the text files
+    char gender;
+    uint8_t isPublic;
+    uint8_t padding[6];
+};
+
+// A post's ID is at textOffset, its content at contentOffset, inside the content block.
+struct SnapshotPost {
+    uint64_t textOffset;
+    uint64_t contentOffset;
+    uint32_t postIdLength;
+    uint32_t contentLength;
+    int64_t timestamp;
+    uint32_t authorIndex;
+    uint8_t isPublic;
+    uint8_t padding[3];
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    uint64_t userCount;
+    uint64_t edgeCount;
+    uint64_t postCount;
+    uint64_t stringBytes;
+    uint64_t contentBytes; // the post content block at the end of the strings
+};
+
+struct SnapshotUserText {
+    std::string_view userId, userName, email, password, location;
+};
+
+struct SnapshotPostText {
+    std::string_view postId, content;
+};
+
+bool writeSnapshot(const std::string& path, const std::vector<User*>& users, const PostStore& posts);
+
+// Validates and maps a snapshot; the accessors point straight into the mapping.
+class SnapshotReader {
+private:
+    MappedFile file;
+    const SnapshotHeader* header = nullptr;
+    const SnapshotUser* users = nullptr;
+    const uint64_t* friendOffsets = nullptr;
+    const uint32_t* friendIndices = nullptr;
+    const SnapshotPost* posts = nullptr;
+    const char* strings = nullptr;
+public:
+    bool open(const std::string& path);
+
+    uint64_t userCount() const { return header->userCount; }
+    uint64_t postCount() const { return header->postCount; }
+    uint64_t stringBytes() const { return header->stringBytes; }
+    std::string_view text() const { return {strings, header->stringBytes}; }
+    std::string_view postContents() const { return text().substr(header->stringBytes - header->contentBytes); }
+    const SnapshotUser& user(uint64_t index) const { return users[index]; }
+    const SnapshotPost& post(uint64_t index) const { return posts[index]; }
+    const uint32_t* friendsBegin(uint64_t userIndex) const { return friendIndices + friendOffsets[userIndex]; }
+    const uint32_t* friendsEnd(uint64_t userIndex) const { return friendIndices + friendOffsets[userIndex + 1]; }
+    SnapshotUserText userText(const SnapshotUser& record) const;
+    SnapshotPostText postText(const SnapshotPost& record) const;
+    // Hands the mapping over, so the views above can outlive the reader.
+    MappedFile takeMapping() { return std::move(file); }
+};
+#endif //SNAPSHOT_H
@@ -0,0 +1,43 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/* Interns strings: every distinct text is stored once and named by a dense 32-bit key, handed
+   out in first-seen order. Users and posts keep keys instead of std::string members, so equal
+   names, locations or IDs share one copy and comparing two of them is an integer compare.
+
+   Text lives in large append-only blocks, so the views returned by view() stay valid until
+   clear(). Text inside a borrow()ed region, e.g. a mapped snapshot, is kept as a view instead of
+   copied; the region has to outlive the pool or its next clear(). Not thread-safe; loaders intern while merging their chunks in file order, which also
+   makes the keys identical from run to run. */
+class StringPool {
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t blockUsed = BLOCK_SIZE;
+    size_t storedBytes = 0;
+    std::string_view borrowed;
+    std::vector<std::string_view> texts; // key -> text
+    std::unordered_map<std::string_view, uint32_t> keys;
+
+    std::string_view store(std::string_view text);
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    void borrow(std::string_view region) { borrowed = region; }
+    uint32_t intern(std::string_view text);
+    uint32_t find(std::string_view text) const;
+    std::string_view view(uint32_t key) const { return texts[key]; }
+    void clear();
+    // Room for 'count' keys in total without rehashing.
+    void reserve(size_t count);
+    size_t size() const { return texts.size(); }
+    size_t bytes() const { return storedBytes; } // copied into the pool, borrowed text excluded
+};
+#endif //STRINGPOOL_H
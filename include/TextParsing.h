@@ -0,0 +1,70 @@
+#ifndef TEXTPARSING_H
+#define TEXTPARSING_H
+#include <charconv>
+#include <string_view>
+#include <vector>
+
+// Helpers for the '#'-separated DataStorage formats. Everything works on string_views into
+// the source buffer, nothing is copied.
+
+// Pops the next line off 'remaining' (without the '\n' or a trailing '\r').
+inline bool nextLine(std::string_view& remaining, std::string_view& line) {
+    if (remaining.empty())
+        return false;
+    size_t end = remaining.find('\n');
+    if (end == std::string_view::npos) {
+        line = remaining;
+        remaining = {};
+    } else {
+        line = remaining.substr(0, end);
+        remaining.remove_prefix(end + 1);
+    }
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+    return true;
+}
+
+// Splits 'line' on 'delimiter' into at most maxFields views and returns the total number of
+// fields in the line, so callers can reject lines with too many or too few.
+inline size_t splitFields(std::string_view line, char delimiter, std::string_view* fields, size_t maxFields) {
+    size_t count = 0;
+    size_t start = 0;
+    while (true) {
+        size_t end = line.find(delimiter, start);
+        std::string_view field = line.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+        if (count < maxFields)
+            fields[count] = field;
+        count++;
+        if (end == std::string_view::npos)
+            return count;
+        start = end + 1;
+    }
+}
+
+// Cuts 'text' into at most chunkCount pieces of roughly equal size, each ending on a line
+// boundary, so the pieces can be parsed independently and concatenated in order.
+inline std::vector<std::string_view> splitIntoLineChunks(std::string_view text, size_t chunkCount) {
+    std::vector<std::string_view> chunks;
+    if (chunkCount == 0)
+        chunkCount = 1;
+    size_t target = text.size() / chunkCount + 1;
+    while (!text.empty()) {
+        size_t cut = text.size();
+        if (target < text.size()) {
+            size_t newline = text.find('\n', target);
+            if (newline != std::string_view::npos)
+                cut = newline + 1;
+        }
+        chunks.push_back(text.substr(0, cut));
+        text.remove_prefix(cut);
+    }
+    return chunks;
+}
+
+// Whole-field integer parse; unlike stoi/stoll it neither allocates nor throws.
+template <typename T>
+bool parseNumber(std::string_view text, T& value) {
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && ptr == text.data() + text.size();
+}
+#endif //TEXTPARSING_H
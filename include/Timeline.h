@@ -0,0 +1,104 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+class User;
+class PostStore;
+
+// Bounded list of PostStore rows, oldest first like User::postsByTime(). 'truncated' means older
+// posts were dropped, so running past the start of the buffer doesn't mean there is nothing older.
+class FeedBuffer {
+private:
+    std::vector<uint32_t> posts;
+    bool truncated = false;
+public:
+    void insert(const PostStore& store, uint32_t row, size_t capacity);
+    void assign(std::vector<uint32_t> newestFirst, bool hasOlder);
+    const std::vector<uint32_t>& oldestFirst() const { return posts; }
+    bool isTruncated() const { return truncated; }
+};
+
+// Where the previous page stopped. The next page starts strictly after this post in feed order.
+struct FeedCursor {
+    bool atStart = true;
+    std::chrono::system_clock::rep ticks = 0;
+    uint32_t row = 0;
+};
+
+// One time-sorted input of a feed merge, consumed from the newest end. 'remaining' is the
+// number of posts not yet taken; a truncated source may be missing posts older than its oldest.
+struct FeedSource {
+    static constexpr uint32_t NO_AUTHOR = UINT32_MAX;
+
+    const std::vector<uint32_t>* posts;
+    size_t remaining;
+    uint32_t skipAuthor; // graph index of an author whose posts are skipped, NO_AUTHOR for none
+    bool truncated;
+};
+
+struct FeedPage {
+    std::vector<uint32_t> posts; // PostStore rows, newest first
+    FeedCursor next;
+    bool hasMore = false;
+};
+
+/* Fan-out-on-write home feeds. A user's feed is every post by their friends plus the public posts
+   of friends-of-friends. New posts are pushed into the precomputed FeedBuffer of every affected
+   user, so the first pages of a feed are mostly a slice of that buffer.
+
+   To keep a single write bounded, high-degree users are special-cased (hybrid push/pull):
+     - posts by a celebrity (more than celebrityThreshold friends) are not fanned out at all;
+       readers pull them from the author at read time;
+     - a public post is not expanded through a celebrity friend to that celebrity's millions of
+       friends; it goes into the celebrity's hub buffer once, which their friends merge on read.
+
+   Every read is a k-way merge over time-sorted sources (buffers and per-author post lists) with a
+   heap of one entry per source, stopped after 'limit' posts: O(k + limit * log k), independent of
+   how many posts the authors have. The merge compares rows through the PostStore timestamp
+   column and never touches post content. Pages beyond what the bounded buffers hold fall back to
+   merging the authors' own post lists directly.
+
+   Buffers are built lazily on first read and dropped when the surrounding friend graph changes.
+
+   Threading: onPostCreated, onFriendshipChanged and clear need the caller to exclude every other
+   call (FakeBook holds its state lock exclusively). queryFeed may run on many threads at once
+   while nothing else runs: the lazily built caches are split into shards by graph index, each
+   with its own mutex, and the merge scratch space is per thread. */
+class TimelineService {
+private:
+    static constexpr size_t SHARDS = 64;
+
+    struct alignas(64) Shard {
+        std::mutex mutex; // only taken by queryFeed; the writers run alone
+        std::unordered_map<const User*, FeedBuffer> timelines;    // materialised home feeds
+        std::unordered_map<const User*, FeedBuffer> hubTimelines; // public posts of a celebrity's regular friends
+        std::unordered_map<const User*, std::vector<User*>> celebrityFriends;
+    };
+
+    const PostStore& store;
+    size_t capacity;
+    size_t celebrityThreshold;
+    std::array<Shard, SHARDS> shards;
+
+    Shard& shardOf(const User* user);
+    FeedBuffer* findBuffer(std::unordered_map<const User*, FeedBuffer> Shard::*map, const User* user);
+    FeedBuffer& timelineOf(User* viewer);
+    FeedBuffer& hubTimelineOf(User* hub);
+    const std::vector<User*>& celebrityFriendsOf(User* user);
+    bool queryFromBuffers(User* viewer, size_t limit, const FeedCursor& cursor, FeedPage& page);
+    void queryFromAuthors(User* viewer, size_t limit, const FeedCursor& cursor, FeedPage& page);
+public:
+    TimelineService(const PostStore& _store, size_t _capacity, size_t _celebrityThreshold);
+
+    bool isCelebrity(const User* user) const;
+    void onPostCreated(uint32_t row);
+    void onFriendshipChanged(User* user, User* other);
+    void clear();
+    FeedPage queryFeed(User* viewer, size_t limit, const FeedCursor& cursor);
+};
+#endif //TIMELINE_H
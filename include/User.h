@@ -1,62 +1,145 @@
 #ifndef USER_H
 #define USER_H
+#include <atomic>
+#include <ostream>
 #include <string>
-#include <list>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <chrono>
-class Post;
+#include <cstdint>
+#include "Credential.h"
+#include "FriendGraph.h"
+#include "StringPool.h"
+class PostStore;
+
+// What the user typed for a new post; FakeBook::createPost gives it an ID and stores it.
+struct PostDraft {
+    std::string content;
+    bool isPublic;
+};
+
+class User;
+
+// What 'viewer' may see of another profile, see FakeBook::viewProfile. 'posts' is a copy of the
+// visible PostStore rows, oldest first, and empty unless 'fullAccess'.
+struct ProfileView {
+    const User* user = nullptr;
+    bool fullAccess = false;
+    std::vector<uint32_t> posts;
+};
 
 class User {
 private:
-    std::string userName;
-    std::string email;
-    std::string password;
+    const StringPool* strings; // userId, userName, email and location are keys into this pool
+    uint32_t userIdKey;
+    uint32_t userNameKey;
+    uint32_t emailKey;
+    uint32_t locationKey;
+    Credential credential;
     int age;
     char gender;
-    std::string location;
-    bool isPublicProfile;
-    std::list<User*> friends;
-    std::string userId;
-    std::vector<Post*> posts;
+    std::atomic<bool> isPublicProfile; // the one field sessions may change under a shared lock
+    FriendGraph* graph = nullptr; // owns this user's friend list, see FakeBook::friendGraph
+    uint32_t graphIndex = 0;
+    std::vector<uint32_t> posts;       // PostStore rows, oldest first
+    std::vector<uint32_t> publicPosts; // oldest first, the part friends-of-friends can see
     std::chrono::system_clock::time_point createdAt;
 public:
-    User(std::string uName, std::string uId, std::string email, std::string password, int _age,
-         char _gender, std::string _location, bool _isPublicProfile, std::chrono::system_clock::time_point _createdAt);
+    User(StringPool& pool, std::string_view uName, std::string_view uId, std::string_view email, Credential _credential,
+         int _age, char _gender, std::string_view _location, bool _isPublicProfile,
+         std::chrono::system_clock::time_point _createdAt);
 
-    std::string getUserId() {
-        return userId;
+    std::string_view getUserId() const {
+        return strings->view(userIdKey);
+    }
+    uint32_t getUserIdKey() const {
+        return userIdKey;
+    }
+    uint32_t getUserNameKey() const {
+        return userNameKey;
+    }
+    uint32_t getEmailKey() const {
+        return emailKey;
+    }
+    uint32_t getLocationKey() const {
+        return locationKey;
+    }
+    void addPost(const PostStore& store, uint32_t row);
+    void addLoadedPost(uint32_t row);
+    void sortPostsByTime(const PostStore& store);
+    void attachToGraph(FriendGraph* _graph, uint32_t _graphIndex) {
+        graph = _graph;
+        graphIndex = _graphIndex;
+    }
+    uint32_t getGraphIndex() const {
+        return graphIndex;
     }
-    void addPost(Post* _post) {
-        posts.push_back(_post);
+    bool addFriend(User* friendUser) {
+        return graph->addEdge(graphIndex, friendUser->graphIndex);
     }
-    void addFriend(User* friendUser) {
-        friends.push_back(friendUser);
+    std::string_view getEmail() const {
+        return strings->view(emailKey);
     }
-    std::string getEmail() const {
-        return email;
+    const Credential& getCredential() const {
+        return credential;
     }
-    std::string getPassword() const {
-        return password;
+    void setCredential(Credential _credential) {
+        credential = std::move(_credential);
     }
-    std::list<User*> getFriends() const {
-        return friends;
+    FriendGraph::FriendRange getFriends() const {
+        return graph->friendsOf(graphIndex);
     }
-    std::string getUserName() const {
-        return userName;
+    std::string_view getUserName() const {
+        return strings->view(userNameKey);
     }
-    std::vector<Post*> getPosts() const {
+    const std::vector<uint32_t>& getPosts() const {
         return posts;
     }
+    const std::vector<uint32_t>& postsByTime() const {
+        return posts;
+    }
+    const std::vector<uint32_t>& publicPostsByTime() const {
+        return publicPosts;
+    }
+    // Users.txt line without the newline: userId#username#email#password#location#gender#age#visibility#createdAt
+    void writeUserLine(std::ostream& out) const;
+    // Friends.txt line without the newline: userId:friendId,friendId,...
+    void writeFriendLine(std::ostream& out) const;
     bool isPublic() const {
-        return isPublicProfile;
+        return isPublicProfile.load(std::memory_order_relaxed);
+    }
+    void setPublic(bool _isPublicProfile) {
+        isPublicProfile.store(_isPublicProfile, std::memory_order_relaxed);
+    }
+    int getAge() const {
+        return age;
+    }
+    char getGender() const {
+        return gender;
+    }
+    std::string_view getLocation() const {
+        return strings->view(locationKey);
+    }
+    std::chrono::system_clock::time_point getCreatedAt() const {
+        return createdAt;
+    }
+    bool removeFriend(User* exFriend) {
+        return graph->removeEdge(graphIndex, exFriend->graphIndex);
+    }
+    size_t friendCount() const {
+        return graph->degree(graphIndex);
+    }
+    bool hasFriend(const User* other) const {
+        return graph->hasEdge(graphIndex, other->graphIndex);
     }
-    void removeFriend(User* exFriend) {
-        friends.remove(exFriend);
+    size_t mutualFriendCount(const User* other) const {
+        return graph->commonNeighbourCount(graphIndex, other->graphIndex);
     }
-    Post* createPost();
-    void changePrivacySetting();
-    void viewOwnProfile();
-    void viewOtherProfile(User* other);
-    void viewFeed(); // TODO: Min-heap sort.
+    PostDraft promptNewPost();
+    bool promptPrivacySetting();
+    void viewOwnProfile(const PostStore& store);
+    void viewOtherProfile(const ProfileView& profile, const PostStore& store);
+    void viewFeed(const PostStore& store, const std::vector<uint32_t>& feedPosts, size_t pageNumber);
 };
 #endif //USER_H
@@ -0,0 +1,34 @@
+#ifndef USERDIRECTORY_H
+#define USERDIRECTORY_H
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+class User;
+class StringPool;
+
+// Indexes over the loaded users so lookups by userId, username or email are O(1). Users keep
+// those strings as keys into a StringPool, so a lookup is one hash probe into the pool followed
+// by plain array indexing. The directory does not own the users, FakeBook does.
+class UserDirectory {
+private:
+    const StringPool& strings;
+    // indexed by pool key, nullptr where the key is not that kind of string
+    std::vector<User*> byId;
+    std::vector<User*> byUsername;
+    std::vector<User*> byEmail;
+    size_t count = 0;
+
+    User* findByKey(const std::vector<User*>& index, std::string_view text) const;
+public:
+    explicit UserDirectory(const StringPool& _strings);
+
+    bool add(User* user);
+    void clear();
+    size_t size() const { return count; }
+
+    User* findById(std::string_view userId) const;
+    User* findByUsername(std::string_view username) const;
+    User* findByEmail(std::string_view email) const;
+};
+#endif //USERDIRECTORY_H
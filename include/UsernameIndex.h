@@ -0,0 +1,86 @@
+#ifndef USERNAMEINDEX_H
+#define USERNAMEINDEX_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+class User;
+
+struct UsernameMatch {
+    User* user = nullptr;
+    uint32_t distance = 0;      // edits between the typed text and the start of the username
+    bool isFriend = false;      // of the viewer
+    uint32_t mutualFriends = 0; // shared with the viewer
+};
+
+/* Username autocomplete: the users whose name starts with a typed prefix, or nearly does.
+
+   Names are case-folded and kept sorted in one text buffer, which doubles as a trie: the names
+   under any trie node are one contiguous range, and a node's children are found by binary search
+   on the next character. A prefix is therefore one range, and typo-tolerant matching walks the
+   trie with a Damerau-Levenshtein row per node, pruning any branch already more than
+   maxEditsFor() edits away. Nodes over EXPLICIT_NODE_NAMES names, the few near the root, keep
+   their children listed instead, as those searches would jump all over the buffer.
+
+   Ranges are ranked without being scanned by a tournament table: every group of FANOUT names,
+   FANOUT groups, and so on up, keeps its TOP_PER_GROUP most popular names (by friend count when
+   the index was built), so the top of any range is read from a few dozen short lists.
+
+   complete() then re-ranks those candidates, plus any of the viewer's friends that match, so
+   that closer matches come first, and among equally close ones friends, then more mutual friends,
+   then more popular users. Users signed up since the last build wait in a small sorted side list
+   until PENDING_LIMIT of them trigger a rebuild. Not thread-safe; FakeBook's stateLock guards it. */
+class UsernameIndex {
+public:
+    static constexpr size_t FANOUT = 32;
+    static constexpr size_t TOP_PER_GROUP = 16; // also the most matches complete() returns
+    static constexpr size_t PENDING_LIMIT = 256;
+    static constexpr size_t MAX_FRIENDS_SCANNED = 1024; // of the viewer's friends, checked for a match
+    static constexpr uint32_t EXPLICIT_NODE_NAMES = 256;
+
+    struct TrieNode {
+        uint32_t lo; // the node's names
+        uint32_t hi;
+        uint32_t firstChild; // into trieNodes; a node's children are contiguous
+        uint32_t childCount; // 0 when the node is too small to have them listed
+        char c;
+    };
+private:
+    std::string nameText;              // folded names in sorted order, back to back
+    std::vector<uint32_t> nameOffsets; // size() + 1 offsets into nameText
+    std::vector<User*> users;
+    std::vector<uint32_t> popularity;
+    std::vector<TrieNode> trieNodes;   // the root first
+    std::vector<std::vector<uint32_t>> topLevels; // level i groups FANOUT^(i+1) names, TOP_PER_GROUP slots each
+    std::vector<std::pair<std::string, User*>> pending; // signed up since build(), sorted by folded name
+
+    std::string_view nameAt(uint32_t index) const {
+        return std::string_view(nameText).substr(nameOffsets[index], nameOffsets[index + 1] - nameOffsets[index]);
+    }
+    bool morePopular(uint32_t a, uint32_t b) const {
+        return popularity[a] != popularity[b] ? popularity[a] > popularity[b] : a < b;
+    }
+    void buildTrieNodes();
+    void buildTopLevels();
+    // Adds to the heap 'best' the 'want' most popular names in [lo, hi), using 'levels' table levels.
+    void collectTop(size_t levels, uint32_t lo, uint32_t hi, size_t want, std::vector<uint32_t>& best) const;
+    void offer(uint32_t index, size_t want, std::vector<uint32_t>& best) const;
+public:
+    static constexpr size_t MAX_TYPED = 64; // longer queries are cut to this many bytes
+
+    static std::string fold(std::string_view name);
+    // Typos tolerated for a query of this length: none below 3 characters, one below 6, else two.
+    static uint32_t maxEditsFor(size_t length);
+    // Edits between 'typed' and the closest prefix of 'name', or UINT32_MAX when over 'maxEdits'.
+    static uint32_t prefixDistance(std::string_view typed, std::string_view name, uint32_t maxEdits);
+
+    void build(const std::vector<User*>& allUsers);
+    void add(User* user);
+    void clear();
+    size_t size() const { return users.size() + pending.size(); }
+
+    // At most 'limit' (up to TOP_PER_GROUP) users for 'typed', best first. 'viewer' may be null.
+    std::vector<UsernameMatch> complete(std::string_view typed, size_t limit, const User* viewer) const;
+};
+#endif //USERNAMEINDEX_H
@@ -0,0 +1,53 @@
+#include "Fakebook.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+/* Offline statistics of the social graph for ops: degree distribution, connected components,
+   clustering coefficients and the users without friends or posts. Loads DataStorage like FakeBook
+   does, from the snapshot when it is fresh, then writes a JSON report; see GraphAnalytics.
+
+   usage: fakebook_analytics [--output graph_report.json] [--threads N, 0 = one per core (default)]
+                             [--no-snapshot] */
+int main(int argc, char* argv[]) {
+    FakeBookOptions options;
+    options.ingestThreads = 0;
+    options.readOnly = true; // may run next to a live server, so it never writes DataStorage
+    options.searchIndexes = false;
+    std::string outputPath = "graph_report.json";
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            options.ingestThreads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--no-snapshot") == 0)
+            options.useSnapshot = false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    FakeBook fakebookApp(options);
+    auto loaded = std::chrono::steady_clock::now();
+    GraphReport report = fakebookApp.analyzeGraph();
+    auto analyzed = std::chrono::steady_clock::now();
+
+    std::ofstream out(outputPath);
+    if (!out) {
+        std::cerr << "Error opening " << outputPath << " for writing." << std::endl;
+        return 1;
+    }
+    report.writeJson(out);
+    out.close();
+    if (!out) {
+        std::cerr << "Error writing " << outputPath << "." << std::endl;
+        return 1;
+    }
+    std::cout << report.users << " users, " << report.links / 2 << " friendships, " << report.components
+              << " components, " << report.triangles << " triangles." << std::endl;
+    std::cout << "Loaded in " << std::chrono::duration<double>(loaded - start).count() << " s, analyzed on "
+              << report.threads << " threads in " << std::chrono::duration<double>(analyzed - loaded).count()
+              << " s. Report written to " << outputPath << "." << std::endl;
+    return 0;
+}
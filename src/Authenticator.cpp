@@ -1,5 +1,8 @@
 #include "Authenticator.h"
 #include "User.h"
+#include "UserDirectory.h"
+#include "IdGenerator.h"
+#include "Metrics.h"
 #include <iostream>
 #include <fstream>
 #include <chrono>
@@ -8,41 +11,68 @@ void clearCinAuth() {
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 }
 
-Authenticator::Authenticator(std::string _fileName) : fileName(_fileName) {}
+Authenticator::Authenticator(std::string _fileName, unsigned hashThreads, uint32_t _iterations, size_t _maxQueuedLogins)
+    : fileName(_fileName), iterations(_iterations), maxQueuedLogins(_maxQueuedLogins),
+      hashPool(hashThreads) {}
 
-User* Authenticator::login(std::vector<User*>& userList) {
-    std::string email, password;
-
-    std::cout << "Enter email: ";
-    std::getline(std::cin, email);
-    std::cout << "Enter password: ";
-    std::getline(std::cin, password);
-
-    for (User* user : userList) {
-        if (user->getEmail() == email && user->getPassword() == password) {
-            return user;
-        }
+// The directory lookup, and the copy of the stored credential, happen on the calling thread;
+// only the hashing is queued. An unknown email is checked against a dummy hash of the same cost,
+// so response time doesn't reveal which emails exist.
+std::future<LoginResult> Authenticator::authenticate(const UserDirectory& directory, std::string email, std::string password) {
+    if (queuedLogins.fetch_add(1) >= maxQueuedLogins && maxQueuedLogins > 0) {
+        queuedLogins.fetch_sub(1);
+        std::promise<LoginResult> turnedAway;
+        turnedAway.set_value(LoginResult{nullptr, std::nullopt, true});
+        return turnedAway.get_future();
     }
-    return nullptr;
+    User* user = directory.findByEmail(email);
+    std::optional<Credential> stored;
+    if (user != nullptr)
+        stored = user->getCredential();
+    uint32_t workFactor = iterations;
+    return hashPool.submit([this, user, stored = std::move(stored), workFactor, password = std::move(password)]() {
+        ScopedTimer timer(Timer::PasswordHash);
+        LoginResult result;
+        struct Done {
+            std::atomic<size_t>& count;
+            ~Done() { count.fetch_sub(1); }
+        } done{queuedLogins};
+        if (!stored) {
+            Credential::derive(password, workFactor);
+            return result;
+        }
+        if (!stored->verify(password))
+            return result;
+        result.user = user;
+        if (stored->isLegacy() || stored->workFactor() < workFactor)
+            result.upgraded = Credential::derive(password, workFactor);
+        return result;
+    });
 }
 
-User* Authenticator::signUp(std::vector<User*>& userList) {
-    std::string uName, email, password, location;
-    int age;
+std::future<Credential> Authenticator::hashPassword(std::string password) {
+    uint32_t workFactor = iterations;
+    return hashPool.submit([workFactor, password = std::move(password)]() {
+        ScopedTimer timer(Timer::PasswordHash);
+        return Credential::derive(password, workFactor);
+    });
+}
+
+SignUpForm Authenticator::promptSignUp() {
+    SignUpForm form;
     char gender = ' ';
     char privacyChoice = ' ';
-    bool isPublic;
 
     std::cout << "Enter new username: ";
-    std::getline(std::cin, uName);
+    std::getline(std::cin, form.username);
     std::cout << "Enter new email: ";
-    std::getline(std::cin, email);
+    std::getline(std::cin, form.email);
     std::cout << "Enter new password: ";
-    std::getline(std::cin, password);
+    std::getline(std::cin, form.password);
     std::cout << "Enter location: ";
-    std::getline(std::cin, location);
+    std::getline(std::cin, form.location);
     std::cout << "Enter age: ";
-    while (!(std::cin >> age)) {
+    while (!(std::cin >> form.age)) {
         std::cerr << "Invalid age. Please enter a number: ";
         std::cin.clear();
         clearCinAuth();
@@ -55,39 +85,38 @@ User* Authenticator::signUp(std::vector<User*>& userList) {
         gender = toupper(gender);
         clearCinAuth();
     }
-    
+    form.gender = gender;
+
     while (privacyChoice != 'P' && privacyChoice != 'V') {
         std::cout << "Profile privacy (P = Public, V = Private): ";
         std::cin >> privacyChoice;
         privacyChoice = toupper(privacyChoice);
         clearCinAuth();
     }
-    isPublic = (privacyChoice == 'P');
+    form.isPublic = (privacyChoice == 'P');
+    return form;
+}
 
-    for (User* user : userList) {
-        if (user->getEmail() == email) {
-            std::cout << "This email is already taken." << std::endl;
-            return nullptr;
-        }
-    }
-    std::string uId = "u" + std::to_string(userList.size() + 1);
+User* Authenticator::signUp(const SignUpForm& form, Credential credential, Arena<User>& users, StringPool& strings,
+                            IdGenerator& ids, std::vector<User*>& userList, UserDirectory& directory) {
+    if (directory.findByEmail(form.email) != nullptr)
+        return nullptr;
+    std::string uId = "u" + std::to_string(ids.next());
     auto createdAt = std::chrono::system_clock::now();
-    long long timestampSeconds = std::chrono::duration_cast<std::chrono::seconds>(createdAt.time_since_epoch()).count();
 
     std::ofstream userFile(fileName, std::ios::app);
     if (!userFile.is_open()) {
         std::cerr << "Error: Could not open " << fileName << " for appending." << std::endl;
         return nullptr;
     }
-
-    // Format: userId#username#email#password#location#gender#age#isPublic#createdAt
-    userFile << uId << "#" << uName << "#" << email << "#" << password << "#" << location << "#" << gender << "#"
-             << age << "#" << (isPublic ? "Public" : "Private") << "#"<< timestampSeconds << std::endl;
-    userFile.close();
-
-    User* newUser = new User(
-        uName, uId, email, password, age, gender, location, isPublic, createdAt
+    User* newUser = users.create(
+        strings, form.username, uId, form.email, std::move(credential), form.age, form.gender, form.location,
+        form.isPublic, createdAt
     );
+    newUser->writeUserLine(userFile);
+    userFile << std::endl;
+    userFile.close();
     userList.push_back(newUser);
+    directory.add(newUser);
     return newUser;
-}
\ No newline at end of file
+}
@@ -0,0 +1,198 @@
+#include "BatchRunner.h"
+#include "Fakebook.h"
+#include "MappedFile.h"
+#include "TextParsing.h"
+#include "User.h"
+#include <iomanip>
+#include <iostream>
+
+const char* const BATCH_OP_NAMES[] = {"LOGIN", "SIGNUP", "LOGOUT", "POST", "REQUEST", "ACCEPT",
+                                      "DECLINE", "UNFRIEND", "FEED", "MORE", "PROFILE", "PRIVACY", "SEARCH", "SUGGEST",
+                                      "RECOMMEND", "CONNECT"};
+
+// Field count each command needs, including the command itself.
+const size_t BATCH_OP_FIELDS[] = {3, 8, 1, 3, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 2, 2};
+
+const char* batchOpName(BatchOp op) {
+    return BATCH_OP_NAMES[static_cast<size_t>(op)];
+}
+
+bool parseCommand(std::string_view line, BatchOp& op, std::string_view* fields) {
+    size_t fieldCount = splitFields(line, '#', fields, MAX_COMMAND_FIELDS);
+    // a search query is the rest of the line, '#' and all; it is never stored. A post's content
+    // is too, so that createPost can refuse it rather than the post being cut short.
+    if (fieldCount > 3 && (fields[0] == "POST" || fields[0] == "SEARCH")) {
+        fields[2] = line.substr(static_cast<size_t>(fields[2].data() - line.data()));
+        fieldCount = 3;
+    }
+    for (size_t i = 0; i < static_cast<size_t>(BatchOp::Count); ++i) {
+        if (fields[0] == BATCH_OP_NAMES[i]) {
+            op = static_cast<BatchOp>(i);
+            return fieldCount == BATCH_OP_FIELDS[i];
+        }
+    }
+    return false;
+}
+
+// Every command but LOGIN, which alone can come back busy; true when FakeBook did it.
+bool executeRefusableCommand(FakeBook& fakebook, CommandSession& session, BatchOp op, const std::string_view* fields,
+                             std::vector<uint32_t>& shown) {
+    switch (op) {
+        case BatchOp::SignUp: {
+            SignUpForm form;
+            form.username = fields[1];
+            form.email = fields[2];
+            form.password = fields[3];
+            form.location = fields[4];
+            if (!parseNumber(fields[5], form.age) || (fields[6] != "M" && fields[6] != "F"))
+                return false;
+            form.gender = fields[6][0];
+            form.isPublic = fields[7] == "Public";
+            session.user = fakebook.signUp(form);
+            session.cursor = {};
+            return session.user != nullptr;
+        }
+        case BatchOp::Logout:
+            session.user = nullptr;
+            return true;
+        case BatchOp::Post:
+            return fakebook.createPost(session.user, {std::string(fields[2]), fields[1] == "Public"}) != NO_POST;
+        case BatchOp::Request:
+        case BatchOp::Accept:
+        case BatchOp::Decline:
+        case BatchOp::Unfriend:
+        case BatchOp::Profile:
+        case BatchOp::Connect: {
+            User* other = fakebook.usernameToPointer(fields[1]);
+            if (other == nullptr)
+                return false;
+            if (op == BatchOp::Connect)
+                return !fakebook.findConnection(session.user, other).path.empty();
+            if (op == BatchOp::Request) {
+                RequestOutcome outcome = fakebook.sendRequest(session.user, other);
+                return outcome == RequestOutcome::Sent || outcome == RequestOutcome::BecameFriends;
+            }
+            if (op == BatchOp::Accept || op == BatchOp::Decline)
+                return fakebook.respondToRequest(session.user, other, op == BatchOp::Accept);
+            if (op == BatchOp::Unfriend)
+                return fakebook.removeFriend(session.user, other);
+            ProfileView profile = fakebook.viewProfile(session.user, other);
+            shown = std::move(profile.posts);
+            return profile.fullAccess;
+        }
+        case BatchOp::Feed:
+        case BatchOp::More: {
+            size_t limit = 0;
+            if (!parseNumber(fields[1], limit) || limit == 0)
+                return false;
+            if (op == BatchOp::Feed)
+                session.cursor = {};
+            FeedPage page = fakebook.getFeed(session.user, limit, session.cursor);
+            session.cursor = page.next;
+            shown = std::move(page.posts);
+            return !shown.empty();
+        }
+        case BatchOp::Search: {
+            size_t limit = 0;
+            if (!parseNumber(fields[1], limit) || limit == 0)
+                return false;
+            shown = fakebook.searchPosts(session.user, fields[2], limit).posts;
+            return !shown.empty();
+        }
+        case BatchOp::Suggest: {
+            size_t limit = 0;
+            if (!parseNumber(fields[1], limit) || limit == 0)
+                return false;
+            return !fakebook.suggestUsernames(session.user, fields[2], limit).empty();
+        }
+        case BatchOp::Recommend: {
+            size_t limit = 0;
+            if (!parseNumber(fields[1], limit) || limit == 0)
+                return false;
+            return !fakebook.recommendFriends(session.user, limit).empty();
+        }
+        case BatchOp::Privacy:
+            fakebook.setPrivacy(session.user, fields[1] == "Public");
+            return true;
+        case BatchOp::Login: // see executeCommand
+        case BatchOp::Count:
+            break;
+    }
+    return false;
+}
+
+CommandResult executeCommand(FakeBook& fakebook, CommandSession& session, BatchOp op, const std::string_view* fields,
+                             std::vector<uint32_t>& shown) {
+    shown.clear();
+    if (op != BatchOp::Login)
+        return executeRefusableCommand(fakebook, session, op, fields, shown) ? CommandResult::Ok : CommandResult::Failed;
+    LoginResult result = fakebook.login(std::string(fields[1]), std::string(fields[2]));
+    session.user = result.user;
+    session.cursor = {};
+    if (result.busy)
+        return CommandResult::Busy;
+    return result.user != nullptr ? CommandResult::Ok : CommandResult::Failed;
+}
+
+BatchRunner::BatchRunner(FakeBook& _fakebook) : fakebook(_fakebook) {}
+
+bool BatchRunner::run(const std::string& scriptPath) {
+    MappedFile script(scriptPath);
+    if (!script.isOpen()) {
+        std::cerr << "Error: Could not open batch script " << scriptPath << std::endl;
+        return false;
+    }
+    std::string_view remaining = script.view();
+    std::string_view line;
+    std::string_view fields[MAX_COMMAND_FIELDS];
+    std::vector<uint32_t> shown;
+    auto runStart = std::chrono::steady_clock::now();
+    while (nextLine(remaining, line)) {
+        if (line.empty() || line.substr(0, 2) == "//")
+            continue;
+        BatchOp op;
+        if (!parseCommand(line, op, fields) ||
+            (session.user == nullptr && op != BatchOp::Login && op != BatchOp::SignUp)) {
+            ++skipped;
+            continue;
+        }
+        BatchOpStats& opStats = stats[static_cast<size_t>(op)];
+        auto start = std::chrono::steady_clock::now();
+        CommandResult result = executeCommand(fakebook, session, op, fields, shown);
+        opStats.elapsed += std::chrono::steady_clock::now() - start;
+        ++opStats.ops;
+        if (result == CommandResult::Failed)
+            ++opStats.failed;
+        else if (result == CommandResult::Busy)
+            ++opStats.busy;
+        postsRead += shown.size();
+    }
+    total = std::chrono::steady_clock::now() - runStart;
+    return true;
+}
+
+void BatchRunner::printReport(std::ostream& out) const {
+    size_t totalOps = 0;
+    out << "\n--- Batch Report ---" << std::endl;
+    out << std::left << std::setw(10) << "command" << std::right << std::setw(10) << "ops" << std::setw(10) << "failed"
+        << std::setw(10) << "busy" << std::setw(14) << "ms" << std::setw(14) << "us/op" << std::setw(14) << "ops/s" << std::endl;
+    for (size_t i = 0; i < OP_COUNT; ++i) {
+        const BatchOpStats& opStats = stats[i];
+        if (opStats.ops == 0)
+            continue;
+        totalOps += opStats.ops;
+        double seconds = std::chrono::duration<double>(opStats.elapsed).count();
+        out << std::left << std::setw(10) << BATCH_OP_NAMES[i] << std::right << std::setw(10) << opStats.ops
+            << std::setw(10) << opStats.failed << std::setw(10) << opStats.busy << std::fixed << std::setprecision(2)
+            << std::setw(14) << seconds * 1e3
+            << std::setw(14) << seconds * 1e6 / static_cast<double>(opStats.ops) << std::setprecision(0)
+            << std::setw(14) << (seconds > 0 ? static_cast<double>(opStats.ops) / seconds : 0.0) << std::endl;
+        out.unsetf(std::ios::fixed);
+    }
+    double totalSeconds = std::chrono::duration<double>(total).count();
+    out << totalOps << " commands in " << std::fixed << std::setprecision(2) << totalSeconds * 1e3 << " ms, "
+        << std::setprecision(0) << (totalSeconds > 0 ? static_cast<double>(totalOps) / totalSeconds : 0.0)
+        << " ops/s; " << skipped << " lines skipped, " << postsRead << " posts read" << std::endl;
+    out.unsetf(std::ios::fixed);
+    out << std::setprecision(6);
+}
@@ -0,0 +1,144 @@
+#include "ConnectionFinder.h"
+#include "FriendGraph.h"
+#include "User.h"
+#include <algorithm>
+
+const int NO_SIDE = 2;
+
+// The search's working space, per thread and reused like the feed merge's FeedScratch.
+struct SeparationScratch {
+    std::vector<uint64_t> reached[2];             // per side, one bit per graph node
+    std::vector<std::vector<uint32_t>> levels[2]; // levels[side][d]: the nodes first reached d hops from that end
+    size_t levelsUsed[2] = {0, 0};
+    std::vector<uint32_t> row;
+};
+
+SeparationScratch& separationScratch() {
+    thread_local SeparationScratch scratch;
+    return scratch;
+}
+
+bool separationReached(const std::vector<uint64_t>& bits, uint32_t node) {
+    return (bits[node >> 6] >> (node & 63)) & 1;
+}
+
+// A friend of 'node' in 'level', one hop closer to that side's end. Walks whichever of the two
+// is shorter; 'level' may be sorted along the way.
+uint32_t separationParent(const FriendGraph& graph, uint32_t node, std::vector<uint32_t>& level, std::vector<uint32_t>& row) {
+    auto [first, last] = graph.sortedRow(node, row);
+    if (level.size() <= static_cast<size_t>(last - first)) {
+        for (uint32_t candidate : level) {
+            if (graph.hasEdge(node, candidate))
+                return candidate;
+        }
+        return UINT32_MAX;
+    }
+    std::sort(level.begin(), level.end());
+    for (; first != last; ++first) {
+        if (std::binary_search(level.begin(), level.end(), *first))
+            return *first;
+    }
+    return UINT32_MAX;
+}
+
+ConnectionFinder::ConnectionFinder(const FriendGraph& _graph, uint32_t _maxHops) : graph(_graph), maxHops(_maxHops) {
+}
+
+Connection ConnectionFinder::find(const User* from, const User* to) const {
+    Connection connection;
+    uint32_t ends[2] = {from->getGraphIndex(), to->getGraphIndex()};
+    for (uint32_t node : graph.commonNeighbours(ends[0], ends[1]))
+        connection.mutualFriends.push_back(graph.nodeAt(node));
+    if (ends[0] == ends[1]) {
+        connection.path.push_back(graph.nodeAt(ends[0]));
+        connection.visited = 1;
+        return connection;
+    }
+
+    SeparationScratch& scratch = separationScratch();
+    size_t words = (graph.nodeCount() + 63) / 64;
+    uint32_t depth[2] = {0, 0};
+    uint64_t cost[2]; // friendships to walk to expand each side's deepest level
+    for (int side = 0; side < 2; ++side) {
+        if (scratch.reached[side].size() < words)
+            scratch.reached[side].resize(words, 0);
+        if (scratch.levels[side].empty())
+            scratch.levels[side].emplace_back();
+        scratch.levels[side][0].assign(1, ends[side]);
+        scratch.levelsUsed[side] = 1;
+        scratch.reached[side][ends[side] >> 6] |= uint64_t{1} << (ends[side] & 63);
+        cost[side] = graph.degree(ends[side]);
+    }
+
+    // Any meeting is a shortest path: nothing either side reached earlier was reached by both.
+    int meetSide = NO_SIDE;
+    uint32_t meetNode = 0, meetOther = 0;
+    while (meetSide == NO_SIDE && depth[0] + depth[1] < maxHops) {
+        int side = cost[0] <= cost[1] ? 0 : 1;
+        std::vector<std::vector<uint32_t>>& levels = scratch.levels[side];
+        if (levels[depth[side]].empty())
+            break; // everyone that end can reach has been reached
+        if (levels.size() <= depth[side] + 1)
+            levels.emplace_back();
+        std::vector<uint32_t>& next = levels[depth[side] + 1];
+        next.clear();
+        scratch.levelsUsed[side] = depth[side] + 2;
+        std::vector<uint64_t>& mine = scratch.reached[side];
+        const std::vector<uint64_t>& theirs = scratch.reached[1 - side];
+        uint64_t nextCost = 0;
+        for (uint32_t node : levels[depth[side]]) {
+            auto [first, last] = graph.sortedRow(node, scratch.row);
+            for (; first != last; ++first) {
+                uint32_t reached = *first;
+                if (separationReached(mine, reached))
+                    continue;
+                if (separationReached(theirs, reached)) {
+                    meetSide = side;
+                    meetNode = node;
+                    meetOther = reached;
+                    break;
+                }
+                mine[reached >> 6] |= uint64_t{1} << (reached & 63);
+                next.push_back(reached);
+                nextCost += graph.degree(reached);
+            }
+            if (meetSide != NO_SIDE)
+                break;
+        }
+        if (meetSide == NO_SIDE) {
+            ++depth[side];
+            cost[side] = nextCost;
+        }
+    }
+
+    if (meetSide != NO_SIDE) {
+        int otherSide = 1 - meetSide;
+        uint32_t otherDepth = 0; // how far meetOther is from its end
+        while (std::find(scratch.levels[otherSide][otherDepth].begin(), scratch.levels[otherSide][otherDepth].end(),
+                         meetOther) == scratch.levels[otherSide][otherDepth].end())
+            ++otherDepth;
+        std::vector<uint32_t> chains[2]; // each from the meeting point back to its end
+        auto trace = [&](int side, uint32_t node, uint32_t nodeDepth) {
+            chains[side].push_back(node);
+            for (uint32_t d = nodeDepth; d > 0; --d) {
+                node = separationParent(graph, node, scratch.levels[side][d - 1], scratch.row);
+                chains[side].push_back(node);
+            }
+        };
+        trace(meetSide, meetNode, depth[meetSide]);
+        trace(otherSide, meetOther, otherDepth);
+        for (auto it = chains[0].rbegin(); it != chains[0].rend(); ++it)
+            connection.path.push_back(graph.nodeAt(*it));
+        for (uint32_t node : chains[1])
+            connection.path.push_back(graph.nodeAt(node));
+    }
+
+    for (int side = 0; side < 2; ++side) {
+        for (size_t d = 0; d < scratch.levelsUsed[side]; ++d) {
+            connection.visited += scratch.levels[side][d].size();
+            for (uint32_t node : scratch.levels[side][d])
+                scratch.reached[side][node >> 6] &= ~(uint64_t{1} << (node & 63));
+        }
+    }
+    return connection;
+}
@@ -0,0 +1,245 @@
+#include "Credential.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <random>
+
+const std::string_view CREDENTIAL_PREFIX = "pbkdf2-sha256$";
+
+const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+uint32_t rotateRight(uint32_t value, unsigned bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+// One SHA-256 block (FIPS 180-4) over sixteen big-endian message words.
+void sha256Compress(uint32_t state[8], const uint32_t* words) {
+    uint32_t w[64];
+    std::copy(words, words + 16, w);
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i) {
+        uint32_t t1 = h + (rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+        uint32_t t2 = (rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+// Streaming SHA-256 over bytes.
+struct Sha256 {
+    uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    uint8_t block[64];
+    size_t blockUsed = 0;
+    uint64_t totalBytes = 0;
+
+    void compress(const uint8_t* data) {
+        uint32_t words[16];
+        for (int i = 0; i < 16; ++i)
+            words[i] = uint32_t{data[4 * i]} << 24 | uint32_t{data[4 * i + 1]} << 16 | uint32_t{data[4 * i + 2]} << 8 | data[4 * i + 3];
+        sha256Compress(state, words);
+    }
+
+    void update(const uint8_t* data, size_t length) {
+        if (length == 0)
+            return;
+        totalBytes += length;
+        if (blockUsed > 0) {
+            size_t take = std::min(length, sizeof(block) - blockUsed);
+            std::memcpy(block + blockUsed, data, take);
+            blockUsed += take;
+            data += take;
+            length -= take;
+            if (blockUsed < sizeof(block))
+                return;
+            compress(block);
+            blockUsed = 0;
+        }
+        for (; length >= sizeof(block); data += sizeof(block), length -= sizeof(block))
+            compress(data);
+        std::memcpy(block, data, length);
+        blockUsed = length;
+    }
+
+    Sha256Digest finish() {
+        uint64_t totalBits = totalBytes * 8;
+        uint8_t padding[72] = {0x80};
+        size_t padLength = (blockUsed < 56 ? 56 : 120) - blockUsed;
+        for (int i = 0; i < 8; ++i)
+            padding[padLength + i] = static_cast<uint8_t>(totalBits >> (56 - 8 * i));
+        update(padding, padLength + 8);
+        Sha256Digest digest;
+        for (int i = 0; i < 8; ++i) {
+            digest[4 * i] = static_cast<uint8_t>(state[i] >> 24);
+            digest[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+            digest[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+            digest[4 * i + 3] = static_cast<uint8_t>(state[i]);
+        }
+        return digest;
+    }
+};
+
+Sha256Digest sha256(std::string_view data) {
+    Sha256 context;
+    context.update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    return context.finish();
+}
+
+// The key is absorbed into the inner and outer states once. Every later HMAC input is a 32-byte
+// digest, so each iteration is exactly two compressions over a pre-padded block of words, with no
+// byte conversion in between.
+Sha256Digest pbkdf2HmacSha256(std::string_view password, const uint8_t* salt, size_t saltLength, uint32_t iterations) {
+    uint8_t key[64] = {0};
+    if (password.size() > sizeof(key)) {
+        Sha256Digest hashedKey = sha256(password);
+        std::memcpy(key, hashedKey.data(), hashedKey.size());
+    } else {
+        std::memcpy(key, password.data(), password.size());
+    }
+    uint8_t innerPad[64], outerPad[64];
+    for (size_t i = 0; i < sizeof(key); ++i) {
+        innerPad[i] = key[i] ^ 0x36;
+        outerPad[i] = key[i] ^ 0x5c;
+    }
+    Sha256 inner, outer;
+    inner.update(innerPad, sizeof(innerPad));
+    outer.update(outerPad, sizeof(outerPad));
+
+    // U1 = HMAC(salt || INT(1)), through the byte interface
+    Sha256 first = inner;
+    const uint8_t blockIndex[4] = {0, 0, 0, 1};
+    first.update(salt, saltLength);
+    first.update(blockIndex, sizeof(blockIndex));
+    Sha256Digest firstInner = first.finish();
+    Sha256 firstOuter = outer;
+    firstOuter.update(firstInner.data(), firstInner.size());
+    Sha256Digest u = firstOuter.finish();
+
+    // words 0-7 carry the previous digest; the rest is the padding of a 64 + 32 byte message
+    uint32_t block[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0x80000000, 0, 0, 0, 0, 0, 0, (64 + 32) * 8};
+    uint32_t result[8];
+    for (int i = 0; i < 8; ++i) {
+        block[i] = uint32_t{u[4 * i]} << 24 | uint32_t{u[4 * i + 1]} << 16 | uint32_t{u[4 * i + 2]} << 8 | u[4 * i + 3];
+        result[i] = block[i];
+    }
+    for (uint32_t iteration = 1; iteration < iterations; ++iteration) {
+        uint32_t state[8];
+        std::copy(inner.state, inner.state + 8, state);
+        sha256Compress(state, block);
+        std::copy(state, state + 8, block);
+        std::copy(outer.state, outer.state + 8, state);
+        sha256Compress(state, block);
+        for (int i = 0; i < 8; ++i) {
+            block[i] = state[i];
+            result[i] ^= state[i];
+        }
+    }
+    Sha256Digest derived;
+    for (int i = 0; i < 8; ++i) {
+        derived[4 * i] = static_cast<uint8_t>(result[i] >> 24);
+        derived[4 * i + 1] = static_cast<uint8_t>(result[i] >> 16);
+        derived[4 * i + 2] = static_cast<uint8_t>(result[i] >> 8);
+        derived[4 * i + 3] = static_cast<uint8_t>(result[i]);
+    }
+    return derived;
+}
+
+bool constantTimeEquals(const uint8_t* a, const uint8_t* b, size_t length) {
+    uint8_t difference = 0;
+    for (size_t i = 0; i < length; ++i)
+        difference |= a[i] ^ b[i];
+    volatile uint8_t result = difference; // keep the compiler from turning the loop into an early exit
+    return result == 0;
+}
+
+void appendHex(std::string& out, const uint8_t* bytes, size_t length) {
+    const char* digits = "0123456789abcdef";
+    for (size_t i = 0; i < length; ++i) {
+        out.push_back(digits[bytes[i] >> 4]);
+        out.push_back(digits[bytes[i] & 0xf]);
+    }
+}
+
+bool parseHex(std::string_view text, uint8_t* bytes, size_t length) {
+    if (text.size() != 2 * length)
+        return false;
+    for (size_t i = 0; i < length; ++i) {
+        if (std::from_chars(text.data() + 2 * i, text.data() + 2 * i + 2, bytes[i], 16).ptr != text.data() + 2 * i + 2)
+            return false;
+    }
+    return true;
+}
+
+Credential Credential::parse(std::string_view stored) {
+    Credential credential;
+    std::string_view rest = stored;
+    if (rest.substr(0, CREDENTIAL_PREFIX.size()) == CREDENTIAL_PREFIX) {
+        rest.remove_prefix(CREDENTIAL_PREFIX.size());
+        size_t iterationsEnd = rest.find('$');
+        size_t saltEnd = iterationsEnd == std::string_view::npos ? iterationsEnd : rest.find('$', iterationsEnd + 1);
+        uint32_t iterations = 0;
+        if (saltEnd != std::string_view::npos &&
+            std::from_chars(rest.data(), rest.data() + iterationsEnd, iterations).ptr == rest.data() + iterationsEnd &&
+            iterations > 0 &&
+            parseHex(rest.substr(iterationsEnd + 1, saltEnd - iterationsEnd - 1), credential.salt.data(), SALT_BYTES) &&
+            parseHex(rest.substr(saltEnd + 1), credential.hash.data(), credential.hash.size())) {
+            credential.iterations = iterations;
+            return credential;
+        }
+    }
+    credential.legacyPassword = std::string(stored);
+    return credential;
+}
+
+Credential Credential::derive(std::string_view password, uint32_t iterations) {
+    Credential credential;
+    std::random_device random;
+    for (size_t i = 0; i < SALT_BYTES; i += 4) {
+        uint32_t word = random();
+        std::memcpy(credential.salt.data() + i, &word, 4);
+    }
+    credential.iterations = iterations > 0 ? iterations : 1;
+    credential.hash = pbkdf2HmacSha256(password, credential.salt.data(), SALT_BYTES, credential.iterations);
+    return credential;
+}
+
+// Legacy rows compare digests rather than the strings themselves, so the compare is constant-time
+// whatever the lengths.
+bool Credential::verify(std::string_view password) const {
+    Sha256Digest expected = isLegacy() ? sha256(legacyPassword) : hash;
+    Sha256Digest actual = isLegacy() ? sha256(password) : pbkdf2HmacSha256(password, salt.data(), SALT_BYTES, iterations);
+    return constantTimeEquals(expected.data(), actual.data(), expected.size());
+}
+
+std::string Credential::stored() const {
+    if (isLegacy())
+        return legacyPassword;
+    std::string out(CREDENTIAL_PREFIX);
+    out += std::to_string(iterations);
+    out.push_back('$');
+    appendHex(out, salt.data(), salt.size());
+    out.push_back('$');
+    appendHex(out, hash.data(), hash.size());
+    return out;
+}
@@ -1,159 +1,343 @@
 #include "DummyDataGenerator.h"
-#include <fstream>
 #include <algorithm>
-#include <sstream>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <utility>
 
-const int USER_COUNT = 20;
-const int MAX_POSTS_PER_USER = 10;
-const int TOTAL_POSTS = USER_COUNT * MAX_POSTS_PER_USER; // 200 posts at max
 const std::string USERS_FILE = "DataStorage/Users.txt";
+const std::string FRIENDS_FILE = "DataStorage/Friends.txt";
+const std::string POSTS_FILE = "DataStorage/Posts.txt";
+const std::string REQUESTS_FILE = "DataStorage/FriendRequests.txt";
+
+const uint32_t USERS_PER_CHUNK = 1 << 14;
+const size_t EDGES_PER_CHUNK = size_t{1} << 20;
+const uint32_t LOCATION_COUNT = 250; // Country1..Country250, or fewer for a small run
+
+// R-MAT odds of a 1 bit at each level of a user index, in 1/65536ths: c + d = 0.19 + 0.05 of the
+// usual a, b, c, d = 0.57, 0.19, 0.19, 0.05 quadrant split.
+const uint32_t RMAT_ONE_BIT = 15729;
+
+// Seeds for the separate random streams, so e.g. changing the post count leaves friendships alone.
+const uint64_t USER_STREAM = 1;
+const uint64_t EDGE_STREAM = 2;
+const uint64_t POST_STREAM = 3;
+
+template <typename T>
+void appendDecimal(std::string& out, T value) {
+    char digits[24];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, end);
+}
+
+void appendUserId(std::string& out, uint32_t idNumber) {
+    out += 'u';
+    appendDecimal(out, idNumber);
+}
 
-void fillStringPool(std::vector<std::string>& pool, const std::string& prefix, int count) {
-    for (int i = 1; i <= count; ++i) {
-        pool.push_back(prefix + std::to_string(i));
+// One user drawn the way R-MAT picks a row of the adjacency matrix: each of 'scale' levels takes
+// the lower half with odds 0.76, four levels per 64-bit draw, which gives low indices power-law
+// popularity. Indices past the last user are redrawn.
+uint32_t rmatUser(std::mt19937_64& random, unsigned scale, uint32_t userCount) {
+    while (true) {
+        uint64_t index = 0;
+        uint64_t bits = 0;
+        for (unsigned level = 0; level < scale; ++level) {
+            if (level % 4 == 0)
+                bits = random();
+            index = (index << 1) | ((bits & 0xFFFF) < RMAT_ONE_BIT ? 1 : 0);
+            bits >>= 16;
+        }
+        if (index < userCount)
+            return static_cast<uint32_t>(index);
     }
 }
 
-DummyDataGenerator::DummyDataGenerator()
-    : randomizer(std::chrono::system_clock::now().time_since_epoch().count())
+DummyDataGenerator::DummyDataGenerator(const DummyDataOptions& _options)
+    : options(_options),
+      now(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()),
+      pool(_options.threads > 0 ? _options.threads : std::max(1u, std::thread::hardware_concurrency()))
 {
-    fillStringPool(userIdPool, "u", USER_COUNT);
-    fillStringPool(usernamePool, "User", USER_COUNT);
-    fillStringPool(emailPool, "user", USER_COUNT);
-    fillStringPool(passwordPool, "Pass", USER_COUNT);
-    fillStringPool(locationPool, "Country", USER_COUNT);
-    fillStringPool(postIdPool, "p", TOTAL_POSTS);
-    fillStringPool(contentPool, "This is post content no.", TOTAL_POSTS);
-
-    // guarantees unique AND random values as all pools are iterated from start to end
-    std::shuffle(userIdPool.begin(), userIdPool.end(), randomizer);
-    std::shuffle(usernamePool.begin(), usernamePool.end(), randomizer);
-    std::shuffle(emailPool.begin(), emailPool.end(), randomizer);
-    std::shuffle(passwordPool.begin(), passwordPool.end(), randomizer);
-    std::shuffle(locationPool.begin(), locationPool.end(), randomizer);
-    std::shuffle(postIdPool.begin(), postIdPool.end(), randomizer);
-    std::shuffle(contentPool.begin(), contentPool.end(), randomizer);
+    if (options.seed == 0)
+        options.seed = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+    if (options.userCount > 1) {
+        // any multiplier coprime to userCount makes index -> ID a permutation, no pool to shuffle
+        std::mt19937_64 random(chunkSeed(USER_STREAM, SIZE_MAX));
+        idMultiplier = random() % options.userCount;
+        while (std::gcd(idMultiplier, uint64_t{options.userCount}) != 1)
+            idMultiplier = (idMultiplier + 1) % options.userCount;
+        idOffset = random() % options.userCount;
+    }
 }
 
-void DummyDataGenerator::populateUsers() {
-    std::uniform_int_distribution ageDistribution(13, 120);
-    std::uniform_int_distribution boolDistribution(0, 1);
-    std::uniform_int_distribution<> indexDistribution(0, locationPool.size() - 1);
+uint32_t DummyDataGenerator::userIdOf(uint32_t index) const {
+    return static_cast<uint32_t>((index * idMultiplier + idOffset) % options.userCount) + 1;
+}
 
-    std::ofstream userWriter(USERS_FILE);
-    if (!userWriter) {
-        std::cerr << "Error opening " << USERS_FILE << " for writing." << std::endl;
-        return;
-    }
+// splitmix64 of the seed, the stream and the chunk, so neighbouring chunks get unrelated generators.
+uint64_t DummyDataGenerator::chunkSeed(uint64_t stream, size_t chunk) const {
+    uint64_t z = options.seed + stream * 0x9E3779B97F4A7C15ULL + (chunk + 1) * 0xD1B54A32D192ED03ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
 
-    for (int i = 0; i < USER_COUNT; ++i) {
-        int age = ageDistribution(randomizer);
-        char gender = (boolDistribution(randomizer) == 0) ? 'M' : 'F';
-        bool isPublic = (boolDistribution(randomizer) == 1);
-        std::string location = locationPool[indexDistribution(randomizer)];
+bool DummyDataGenerator::writeChunks(const std::string& path, size_t chunkCount,
+                                     const std::function<std::string(size_t)>& makeChunk) const {
+    std::ofstream writer(path, std::ios::binary);
+    if (!writer) {
+        std::cerr << "Error opening " << path << " for writing." << std::endl;
+        return false;
+    }
+    size_t window = 2 * static_cast<size_t>(pool.size());
+    std::deque<std::future<std::string>> inFlight;
+    size_t submitted = 0;
+    while (submitted < chunkCount || !inFlight.empty()) {
+        while (submitted < chunkCount && inFlight.size() < window) {
+            size_t chunk = submitted++;
+            inFlight.push_back(pool.submit([&makeChunk, chunk]() { return makeChunk(chunk); }));
+        }
+        std::string text = inFlight.front().get();
+        inFlight.pop_front();
+        writer.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+    writer.close();
+    if (!writer) {
+        std::cerr << "Error writing " << path << "." << std::endl;
+        return false;
+    }
+    return true;
+}
 
-        std::uniform_int_distribution<> timeElapsedDistribution(0, 100000); // in seconds
-        auto createdAt = std::chrono::system_clock::now() - std::chrono::seconds(timeElapsedDistribution(randomizer));
+void DummyDataGenerator::populateUsers() {
+    std::filesystem::create_directories("DataStorage");
+    uint32_t userCount = options.userCount;
+    uint32_t locationCount = std::max(1u, std::min(userCount, LOCATION_COUNT));
+    size_t chunkCount = (userCount + USERS_PER_CHUNK - 1) / USERS_PER_CHUNK;
 
-        // userId#username#email#password#location#gender#age#isPublic#createdAt
-        userWriter << userIdPool[i] << "#" << usernamePool[i] << "#" << emailPool[i] << "@fakebook.com" << "#"
-                 << passwordPool[i] << "#" << location << "#" << gender << "#" << age << "#"
-                    << (isPublic ? "Public" : "Private") << "#"
-                 << std::chrono::duration_cast<std::chrono::seconds>(createdAt.time_since_epoch()).count();
+    bool written = writeChunks(USERS_FILE, chunkCount, [&](size_t chunk) {
+        std::mt19937_64 random(chunkSeed(USER_STREAM, chunk));
+        std::uniform_int_distribution ageDistribution(13, 120);
+        std::uniform_int_distribution boolDistribution(0, 1);
+        std::uniform_int_distribution<uint32_t> locationDistribution(1, locationCount);
+        std::uniform_int_distribution timeElapsedDistribution(0, 100000); // in seconds
+        std::string text;
+        uint32_t begin = static_cast<uint32_t>(chunk * USERS_PER_CHUNK);
+        uint32_t end = std::min(userCount, begin + USERS_PER_CHUNK);
+        for (uint32_t i = begin; i < end; ++i) {
+            int age = ageDistribution(random);
+            char gender = (boolDistribution(random) == 0) ? 'M' : 'F';
+            bool isPublic = (boolDistribution(random) == 1);
+            uint32_t location = locationDistribution(random);
+            long long createdAt = now - timeElapsedDistribution(random);
 
-        userWriter << std::endl;
-    }
-    userWriter.close();
-    std::cout << "Generated " << USER_COUNT << " users and saved to Users.txt." << std::endl;
+            // userId#username#email#password#location#gender#age#isPublic#createdAt
+            appendUserId(text, userIdOf(i));
+            text += "#User";
+            appendDecimal(text, i + 1);
+            text += "#user";
+            appendDecimal(text, i + 1);
+            text += "@fakebook.com#Pass";
+            appendDecimal(text, i + 1);
+            text += "#Country";
+            appendDecimal(text, location);
+            text += '#';
+            text += gender;
+            text += '#';
+            appendDecimal(text, age);
+            text += isPublic ? "#Public#" : "#Private#";
+            appendDecimal(text, createdAt);
+            text += '\n';
+        }
+        return text;
+    });
+    if (written)
+        std::cout << "Generated " << userCount << " users and saved to Users.txt." << std::endl;
 }
 
 void DummyDataGenerator::populateFriendsAndRequests() {
-    std::ofstream friendWriter("DataStorage/Friends.txt");
-    std::ofstream requestWriter("DataStorage/FriendRequests.txt");
-    if (!friendWriter || !requestWriter) {
-        std::cerr << "Error opening friends/requests files." << std::endl;
-        return;
-    }
-    std::vector<std::vector<std::string>> adjacencyList(USER_COUNT); // to ensure mutuality.
-    std::uniform_int_distribution<> friendProbability(1, 10);
-    std::uniform_int_distribution<> pendingRequestProbability(1, 10);
-
-    int friendCount = 0;
-    int pendingRequestsCount = 0;
-
-    for (int i = 0; i < USER_COUNT; ++i) {
-        std::string currentUserId = userIdPool[i];
-        for (int j = i + 1; j < USER_COUNT; ++j) {
-            std::string potentialFriendId = userIdPool[j];
-            if (friendProbability(randomizer) <= 3) {
-                if (pendingRequestProbability(randomizer) == 1) {
-                    auto timestamp = std::chrono::system_clock::now();
-                    requestWriter << currentUserId << "#" << potentialFriendId << "#"
-                                 << std::chrono::duration_cast<std::chrono::seconds>(timestamp.time_since_epoch()).count() << "#"
-                                 << "PENDING" << std::endl;
-                    pendingRequestsCount++;
-                } else {
-                    adjacencyList[i].push_back(potentialFriendId);
-                    adjacencyList[j].push_back(currentUserId);
-                    friendCount++;
+    std::filesystem::create_directories("DataStorage");
+    uint32_t userCount = options.userCount;
+    unsigned scale = 0;
+    while ((uint64_t{1} << scale) < userCount)
+        ++scale;
+    size_t edgeCount = static_cast<size_t>(userCount) * options.averageDegree / 2;
+    size_t edgeChunkCount = (edgeCount + EDGES_PER_CHUNK - 1) / EDGES_PER_CHUNK;
+
+    // draw every pair; each becomes a friendship, or a pending request 'requestPercent' of the time.
+    // Both ends drawn R-MAT style would leave most users without friends, so a pair starts at a
+    // uniformly chosen user and only its other end is R-MAT: everyone makes about averageDegree / 2
+    // friends, and popularity follows a power law
+    struct EdgeChunk {
+        std::vector<std::pair<uint32_t, uint32_t>> friendships;
+        std::vector<std::pair<uint32_t, uint32_t>> requests;
+    };
+    std::vector<EdgeChunk> edgeChunks(edgeChunkCount);
+    std::vector<std::atomic<uint32_t>> degrees(userCount);
+    {
+        std::vector<std::future<void>> done;
+        for (size_t chunk = 0; chunk < edgeChunkCount; ++chunk) {
+            done.push_back(pool.submit([&, chunk]() {
+                std::mt19937_64 random(chunkSeed(EDGE_STREAM, chunk));
+                EdgeChunk& edges = edgeChunks[chunk];
+                size_t count = std::min(EDGES_PER_CHUNK, edgeCount - chunk * EDGES_PER_CHUNK);
+                edges.friendships.reserve(count);
+                for (size_t k = 0; k < count; ++k) {
+                    uint32_t from = static_cast<uint32_t>(random() % userCount);
+                    uint32_t to = rmatUser(random, scale, userCount);
+                    if (from == to)
+                        continue;
+                    if (random() % 100 < options.requestPercent) {
+                        edges.requests.emplace_back(from, to);
+                        continue;
+                    }
+                    edges.friendships.emplace_back(from, to);
+                    degrees[from].fetch_add(1, std::memory_order_relaxed);
+                    degrees[to].fetch_add(1, std::memory_order_relaxed);
                 }
-            }
+            }));
         }
+        for (std::future<void>& chunk : done)
+            chunk.get();
+    }
+
+    // friend lists side by side, CSR style: user i's friends are adjacency[offsets[i] .. offsets[i + 1])
+    std::vector<uint64_t> offsets(static_cast<size_t>(userCount) + 1, 0);
+    for (uint32_t i = 0; i < userCount; ++i) {
+        offsets[i + 1] = offsets[i] + degrees[i].load(std::memory_order_relaxed);
+        degrees[i].store(0, std::memory_order_relaxed); // reused below as each list's fill position
     }
-    for (int i = 0; i < USER_COUNT; ++i) {
-        std::string userId = userIdPool[i];
-        std::stringstream friendLine;
-        friendLine << userId << ":";
-
-        for (const std::string& friendId : adjacencyList[i])
-            friendLine << friendId << ",";
-
-        std::string finalFriendList = friendLine.str();
-        if (finalFriendList.back() == ',')
-            finalFriendList.pop_back();
-        friendWriter << finalFriendList << std::endl;
+    std::vector<uint32_t> adjacency(offsets[userCount]);
+    {
+        std::vector<std::future<void>> done;
+        for (EdgeChunk& edges : edgeChunks) {
+            done.push_back(pool.submit([&]() {
+                for (auto [from, to] : edges.friendships) {
+                    adjacency[offsets[from] + degrees[from].fetch_add(1, std::memory_order_relaxed)] = to;
+                    adjacency[offsets[to] + degrees[to].fetch_add(1, std::memory_order_relaxed)] = from;
+                }
+                edges.friendships = {};
+            }));
+        }
+        for (std::future<void>& chunk : done)
+            chunk.get();
     }
-    friendWriter.close();
-    requestWriter.close();
-    std::cout << "Generated " << friendCount << " mutual friendships and " << pendingRequestsCount << " pending requests." << std::endl;
+
+    // a pair drawn twice shows up twice on both sides, so sorting and deduplicating each list
+    // keeps friendships mutual; 'friendCounts' is each list's length afterwards
+    std::vector<uint32_t> friendCounts(userCount);
+    std::atomic<size_t> friendEnds{0};
+    size_t userChunkCount = (userCount + USERS_PER_CHUNK - 1) / USERS_PER_CHUNK;
+    bool written = writeChunks(FRIENDS_FILE, userChunkCount, [&](size_t chunk) {
+        std::string text;
+        size_t ends = 0;
+        uint32_t begin = static_cast<uint32_t>(chunk * USERS_PER_CHUNK);
+        uint32_t end = std::min(userCount, begin + USERS_PER_CHUNK);
+        for (uint32_t i = begin; i < end; ++i) {
+            uint32_t* first = adjacency.data() + offsets[i];
+            uint32_t* last = adjacency.data() + offsets[i + 1];
+            std::sort(first, last);
+            last = std::unique(first, last);
+            friendCounts[i] = static_cast<uint32_t>(last - first);
+            ends += friendCounts[i];
+
+            appendUserId(text, userIdOf(i));
+            text += ':';
+            for (uint32_t* other = first; other != last; ++other) {
+                if (other != first)
+                    text += ',';
+                appendUserId(text, userIdOf(*other));
+            }
+            text += '\n';
+        }
+        friendEnds += ends;
+        return text;
+    });
+    if (!written)
+        return;
+
+    // one pending request per pair of users, and none between friends
+    std::vector<std::pair<uint32_t, uint32_t>> requests;
+    for (EdgeChunk& edges : edgeChunks)
+        requests.insert(requests.end(), edges.requests.begin(), edges.requests.end());
+    edgeChunks = {};
+    auto pairKey = [](std::pair<uint32_t, uint32_t> request) {
+        return std::make_pair(std::min(request.first, request.second), std::max(request.first, request.second));
+    };
+    std::sort(requests.begin(), requests.end(), [&](auto a, auto b) { return pairKey(a) < pairKey(b); });
+    requests.erase(std::unique(requests.begin(), requests.end(), [&](auto a, auto b) { return pairKey(a) == pairKey(b); }),
+                   requests.end());
+    std::erase_if(requests, [&](std::pair<uint32_t, uint32_t> request) {
+        const uint32_t* first = adjacency.data() + offsets[request.first];
+        return std::binary_search(first, first + friendCounts[request.first], request.second);
+    });
+
+    size_t requestChunkCount = (requests.size() + EDGES_PER_CHUNK - 1) / EDGES_PER_CHUNK;
+    written = writeChunks(REQUESTS_FILE, requestChunkCount, [&](size_t chunk) {
+        std::string text;
+        size_t end = std::min(requests.size(), (chunk + 1) * EDGES_PER_CHUNK);
+        for (size_t k = chunk * EDGES_PER_CHUNK; k < end; ++k) {
+            appendUserId(text, userIdOf(requests[k].first));
+            text += '#';
+            appendUserId(text, userIdOf(requests[k].second));
+            text += '#';
+            appendDecimal(text, now);
+            text += "#PENDING\n";
+        }
+        return text;
+    });
+    if (written)
+        std::cout << "Generated " << friendEnds / 2 << " mutual friendships and " << requests.size()
+                  << " pending requests." << std::endl;
 }
 
 void DummyDataGenerator::populatePosts() {
-    std::ofstream postWriter("DataStorage/Posts.txt");
-    if (!postWriter) {
-        std::cerr << "Error opening Posts.txt for writing." << std::endl;
-        return;
-    }
-    std::uniform_int_distribution<> postsPerUser(0, MAX_POSTS_PER_USER);
-    std::uniform_int_distribution<> privacyDistribution(0, 1);
-    std::uniform_int_distribution<> contentIndex(0, contentPool.size() - 1);
-    int postIndex = 0;
-    int actualTotalPosts = 0;
-
-    for (int i = 0; i < USER_COUNT; ++i) {
-        int postCounter = postsPerUser(randomizer);
-        std::string authorId = userIdPool[i];
-
-        for (int j = 0; j < postCounter; ++j) {
-            if (postIndex >= TOTAL_POSTS)
-                break;
-
-            std::string postId = postIdPool[postIndex];
-            std::string content = contentPool[contentIndex(randomizer)];
-            bool isPublic = (privacyDistribution(randomizer) == 1);
-
-            std::uniform_int_distribution<> timeElapsed(0, 50000);
-            auto timestamp = std::chrono::system_clock::now() - std::chrono::seconds(timeElapsed(randomizer));
-
-           // postId#authorId#text#timestamp#visibility  for Posts.txt
-            postWriter << postId << "#" << authorId << "#" << content << "#"
-                      << std::chrono::duration_cast<std::chrono::seconds>(timestamp.time_since_epoch()).count() << "#"
-                      << (isPublic ? "Public" : "FriendsOnly") << std::endl;
-            postIndex++;
-            actualTotalPosts++;
+    std::filesystem::create_directories("DataStorage");
+    uint32_t userCount = options.userCount;
+    uint64_t maxPosts = options.maxPostsPerUser;
+    uint64_t contentCount = std::max<uint64_t>(1, userCount * maxPosts);
+    std::atomic<size_t> actualTotalPosts{0};
+    size_t chunkCount = (userCount + USERS_PER_CHUNK - 1) / USERS_PER_CHUNK;
+
+    bool written = writeChunks(POSTS_FILE, chunkCount, [&](size_t chunk) {
+        std::mt19937_64 random(chunkSeed(POST_STREAM, chunk));
+        std::uniform_int_distribution<uint64_t> postsPerUser(0, maxPosts);
+        std::uniform_int_distribution privacyDistribution(0, 1);
+        std::uniform_int_distribution<uint64_t> contentIndex(1, contentCount);
+        std::uniform_int_distribution timeElapsed(0, 50000);
+        std::string text;
+        size_t posts = 0;
+        uint32_t begin = static_cast<uint32_t>(chunk * USERS_PER_CHUNK);
+        uint32_t end = std::min(userCount, begin + USERS_PER_CHUNK);
+        for (uint32_t i = begin; i < end; ++i) {
+            uint64_t postCounter = postsPerUser(random);
+            for (uint64_t j = 0; j < postCounter; ++j) {
+                bool isPublic = (privacyDistribution(random) == 1);
+                // every user owns a block of maxPostsPerUser post numbers, so IDs never collide
+                // postId#authorId#text#timestamp#visibility
+                text += 'p';
+                appendDecimal(text, i * maxPosts + j + 1);
+                text += '#';
+                appendUserId(text, userIdOf(i));
+                text += "#This is post content no.";
+                appendDecimal(text, contentIndex(random));
+                text += '#';
+                appendDecimal(text, now - timeElapsed(random));
+                text += isPublic ? "#Public\n" : "#FriendsOnly\n";
+            }
+            posts += postCounter;
         }
-    }
-    postWriter.close();
-    std::cout << "Generated " << actualTotalPosts << " posts and saved to posts.txt." << std::endl;
-}
\ No newline at end of file
+        actualTotalPosts += posts;
+        return text;
+    });
+    if (written)
+        std::cout << "Generated " << actualTotalPosts << " posts and saved to posts.txt." << std::endl;
+}
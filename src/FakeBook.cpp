@@ -1,6 +1,7 @@
 #include "Fakebook.h"
 #include "User.h"
 #include "Post.h"
+#include "PostStore.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -8,322 +9,1139 @@
 #include <limits>
 #include "Authenticator.h"
 #include "DummyDataGenerator.h"
+#include "MappedFile.h"
+#include "TextParsing.h"
+#include "ThreadPool.h"
+#include "Snapshot.h"
+#include "Metrics.h"
+#include <filesystem>
+#include <algorithm>
+#include <deque>
+#include <functional>
 
 const std::string USERS_FILE_PATH = "DataStorage/Users.txt";
 const std::string FRIENDS_FILE_PATH = "DataStorage/Friends.txt";
 const std::string POSTS_FILE_PATH = "DataStorage/Posts.txt";
 const std::string REQUESTS_FILE_PATH = "DataStorage/FriendRequests.txt";
+const std::string SNAPSHOT_FILE_PATH = "DataStorage/FakeBook.snap";
+const std::string JOURNAL_FILE_PATH = "DataStorage/Journal.log";
+const size_t CHUNKS_PER_THREAD = 4; // a few chunks per worker so one slow chunk doesn't idle the rest
+const size_t USERNAME_SUGGESTIONS = 5;
+const size_t PEOPLE_YOU_MAY_KNOW = 10;
+const size_t MUTUAL_FRIENDS_SHOWN = 20;
+const size_t RECOMMENDATION_CHUNK_USERS = 1024;
 
-User* FakeBook::usernameToPointer(const std::string& username) const {
-    for (User* user : masterUserList) {
-        if (user->getUserName() == username) {
-            return user;
-        }
-    }
-    return nullptr;
+User* FakeBook::usernameToPointer(std::string_view username) const {
+    SharedShardLock lock(stateLock, ShardedSharedMutex::threadKey());
+    return userDirectory.findByUsername(username);
+}
+
+std::vector<UsernameMatch> FakeBook::suggestUsernames(const User* viewer, std::string_view typed, size_t limit) const {
+    ScopedTimer timer(Timer::SuggestUsernames);
+    SharedShardLock lock(stateLock, viewer != nullptr ? viewer->getGraphIndex() : ShardedSharedMutex::threadKey());
+    return usernames.complete(typed, limit, viewer);
 }
 
 void clearCin() {
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 }
 
-User* FakeBook::idToPointer(std::string _userId) const {
-    for (auto i : masterUserList) {
-        if (i->getUserId() == _userId) {
-            return i;
-        }
-    }
-    return nullptr;
+User* FakeBook::idToPointer(std::string_view _userId) const {
+    return userDirectory.findById(_userId);
 }
 
-void FakeBook::parseAllUsers() {
-    std::ifstream userReader(USERS_FILE_PATH);
-    if (!userReader) {
-        std::cerr << "Error opening " << USERS_FILE_PATH << " for reading." << std::endl;
-        return;
+// One parsed Users.txt line. The views point into the mapped file; the User is built, and its
+// strings interned, when the chunks are merged in file order.
+struct UserFields {
+    std::string_view userId, userName, email, password, location;
+    int age;
+    char gender;
+    bool isPublic;
+    std::chrono::system_clock::time_point createdAt;
+};
+
+// One parsed Posts.txt line, appended to the PostStore during the merge like UserFields.
+struct PostFields {
+    User* author;
+    std::string_view postId, content;
+    std::chrono::system_clock::time_point timestamp;
+    bool isPublic;
+};
+
+// Parsed output of one newline-aligned slice of a file. Warnings are buffered so that chunks
+// parsed in parallel still report them in file order during the merge.
+struct UserChunk {
+    std::vector<UserFields> users;
+    std::ostringstream warnings;
+};
+
+struct FriendChunk {
+    std::vector<std::pair<User*, User*>> links;
+    std::ostringstream warnings;
+};
+
+struct PostChunk {
+    std::vector<PostFields> posts;
+    std::ostringstream warnings;
+};
+
+// Runs 'parse' over the file in chunks on the ingest pool, or as a single chunk on this thread
+// when there is no pool. Both paths return chunks in file order, so merging them is deterministic.
+template <typename Chunk, typename ParseFn>
+std::vector<Chunk> parseInChunks(ThreadPool* pool, std::string_view text, ParseFn parse) {
+    if (pool == nullptr) {
+        std::vector<Chunk> chunks(1);
+        parse(text, chunks[0]);
+        return chunks;
     }
-    std::string line;
-    while (std::getline(userReader, line)) {
-        if (line.empty()) continue;
+    std::vector<std::string_view> pieces = splitIntoLineChunks(text, pool->size() * CHUNKS_PER_THREAD);
+    std::vector<Chunk> chunks(pieces.size());
+    std::vector<std::future<void>> pending;
+    pending.reserve(pieces.size());
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        pending.push_back(pool->submit([&pieces, &chunks, &parse, i]() { parse(pieces[i], chunks[i]); }));
+    }
+    for (std::future<void>& done : pending)
+        done.get();
+    return chunks;
+}
 
-        std::stringstream ss(line);
-        std::string segment;
-        std::vector<std::string> fields;
+void parseUserChunk(std::string_view text, UserChunk& chunk) {
+    std::string_view line;
+    std::string_view fields[9];
+    while (nextLine(text, line)) {
+        if (line.empty()) continue;
 
-        while (std::getline(ss, segment, '#')) {
-            fields.push_back(segment);
+        size_t fieldCount = splitFields(line, '#', fields, 9);
+        if (fieldCount != 9) {
+            chunk.warnings << "Warning: Skipping malformed user line with " << fieldCount << " fields: " << line << "\n";
+            continue;
         }
-        if (fields.size() != 9) {
-            std::cerr << "Warning: Skipping malformed user line with " << fields.size() << " fields: " << line << std::endl;
+        int age = 0;
+        long long timestampSeconds = 0;
+        if (fields[5].empty() || !parseNumber(fields[6], age) || !parseNumber(fields[8], timestampSeconds)) {
+            chunk.warnings << "Warning: Skipping user line with bad gender/age/timestamp: " << line << "\n";
             continue;
         }
-        std::string uId = fields[0];
-        std::string uName = fields[1];
-        std::string email = fields[2];
-        std::string password = fields[3];
-        std::string location = fields[4];
-
         char gender = fields[5][0];
-        int age = std::stoi(fields[6]);
         bool isPublic = (fields[7] == "Public");
-
-        long long timestampSeconds = std::stoll(fields[8]);
         auto createdAt = std::chrono::system_clock::time_point(std::chrono::seconds(timestampSeconds));
 
-        User* newUser = new User(uName, uId, email, password, age, gender, location, isPublic, createdAt);
-        masterUserList.push_back(newUser);
+        chunk.users.push_back({fields[0], fields[1], fields[2], fields[3], fields[4], age, gender, isPublic, createdAt});
     }
-    userReader.close();
-    std::cout << "Successfully loaded " << masterUserList.size() << " users into memory." << std::endl;
 }
 
-void FakeBook::parseAllFriends(){
-    if (masterUserList.empty()) {
-        std::cerr << "Cannot parse friends. User list is empty." << std::endl;
-        return;
-    }
-    std::ifstream friendReader(FRIENDS_FILE_PATH);
-    if (!friendReader) {
-        std::cerr << "Error opening " << FRIENDS_FILE_PATH << " for reading." << std::endl;
-        return;
-    }
-    std::string line;
-    int links = 0;
-
-    while (std::getline(friendReader, line)) {
+void parseFriendChunk(const UserDirectory& directory, std::string_view text, FriendChunk& chunk) {
+    std::string_view line;
+    while (nextLine(text, line)) {
         if (line.empty())
             continue;
         size_t colonPos = line.find(':');
-        if (colonPos == std::string::npos)
+        if (colonPos == std::string_view::npos)
             continue;
-        std::string ownerId = line.substr(0, colonPos);
-        std::string friendListStr = line.substr(colonPos + 1);
+        std::string_view ownerId = line.substr(0, colonPos);
+        std::string_view friendListStr = line.substr(colonPos + 1);
 
-        User* owner = idToPointer(ownerId);
+        User* owner = directory.findById(ownerId);
         if (owner == nullptr) {
-            std::cerr << "Undefined user: " << ownerId << std::endl;
+            chunk.warnings << "Undefined user: " << ownerId << "\n";
             continue;
         }
-        if (friendListStr.empty())
-            continue;
-
-        std::stringstream ss(friendListStr);
-        std::string friendId;
-        while (std::getline(ss, friendId, ',')) {
+        while (!friendListStr.empty()) {
+            size_t comma = friendListStr.find(',');
+            std::string_view friendId = friendListStr.substr(0, comma);
+            friendListStr.remove_prefix(comma == std::string_view::npos ? friendListStr.size() : comma + 1);
             if (friendId.empty())
                 continue;
 
-            User* friendUser = idToPointer(friendId);
+            User* friendUser = directory.findById(friendId);
             if (friendUser == nullptr) {
-                std::cerr << "Friend ID not found: " << friendId << ". Skipping link." << std::endl;
+                chunk.warnings << "Friend ID not found: " << friendId << ". Skipping link." << "\n";
                 continue;
             }
-            owner->addFriend(friendUser);
-            links++;
+            chunk.links.emplace_back(owner, friendUser);
         }
     }
-    friendReader.close();
-    std::cout << "Successfully established " << links << " links." << std::endl;
 }
 
-void FakeBook::parseAllPosts() {
-    if (masterUserList.empty()) {
-        std::cerr << "Cannot parse posts. User list is empty. Run parseAllUsers() first." << std::endl;
-        return;
-    }
-    std::ifstream postReader(POSTS_FILE_PATH);
-    if (!postReader) {
-        std::cerr << "Error opening " << POSTS_FILE_PATH << " for reading." << std::endl;
-        return;
-    }
-    std::string line;
-    while (std::getline(postReader, line)) {
+void parsePostChunk(const UserDirectory& directory, std::string_view text, PostChunk& chunk) {
+    std::string_view line;
+    std::string_view fields[5];
+    while (nextLine(text, line)) {
         if (line.empty())
             continue;
-        std::stringstream ss(line);
-        std::string segment;
-        std::vector<std::string> fields;
-
-        while (std::getline(ss, segment, '#')) {
-            fields.push_back(segment);
+        if (splitFields(line, '#', fields, 5) != 5) {
+            chunk.warnings << "Warning: Skipping malformed post line: " << line << "\n";
+            continue;
         }
-        if (fields.size() != 5) {
-            std::cerr << "Warning: Skipping malformed post line: " << line << std::endl;
+        long long timestampSeconds = 0;
+        if (!parseNumber(fields[3], timestampSeconds)) {
+            chunk.warnings << "Warning: Skipping post line with bad timestamp: " << line << "\n";
             continue;
         }
-        std::string postId = fields[0];
-        std::string authorId = fields[1];
-        std::string content = fields[2];
-        long long timestampSeconds = std::stoll(fields[3]);
         auto timeStamp = std::chrono::system_clock::time_point(std::chrono::seconds(timestampSeconds));
         bool isPublic = (fields[4] == "Public");
 
-        User* author = idToPointer(authorId);
+        User* author = directory.findById(fields[1]);
         if (author == nullptr) {
-            std::cerr << "Warning: Skipping post " << postId << ". Author ID not found." << std::endl;
+            chunk.warnings << "Warning: Skipping post " << fields[0] << ". Author ID not found." << "\n";
             continue;
         }
-        Post* newPost = new Post(author, content, timeStamp, isPublic, postId);
-        masterPostList.push_back(newPost);
-        author->addPost(newPost);
+        chunk.posts.push_back({author, fields[0], fields[2], timeStamp, isPublic});
     }
-    postReader.close();
-    std::cout << "Successfully loaded " << masterPostList.size() << " posts into memory." << std::endl;
 }
 
-FakeBook::FakeBook() {
-    parseAllUsers();
-    parseAllFriends();
-    parseAllPosts();
+void FakeBook::parseAllUsers() {
+    ScopedTimer timer(Timer::ParseUsers);
+    MappedFile userFile(USERS_FILE_PATH);
+    if (!userFile.isOpen()) {
+        std::cerr << "Error opening " << USERS_FILE_PATH << " for reading." << std::endl;
+        return;
+    }
+    std::vector<UserChunk> chunks = parseInChunks<UserChunk>(ingestPool.get(), userFile.view(), parseUserChunk);
+
+    for (UserChunk& chunk : chunks) {
+        std::cerr << chunk.warnings.str();
+        for (const UserFields& fields : chunk.users) {
+            User* newUser = userArena.create(strings, fields.userName, fields.userId, fields.email, Credential::parse(fields.password),
+                                             fields.age, fields.gender, fields.location, fields.isPublic, fields.createdAt);
+            if (!userDirectory.add(newUser))
+                std::cerr << "Warning: Duplicate user ID " << newUser->getUserId() << ", lookups will resolve to the first one." << std::endl;
+            masterUserList.push_back(newUser);
+            friendGraph.addNode(newUser);
+            recommender.addUser(newUser);
+        }
+    }
+    std::cout << "Successfully loaded " << masterUserList.size() << " users into memory." << std::endl;
 }
 
-void FakeBook::appendPost(Post* newPost) {
-    std::ofstream postWriter(POSTS_FILE_PATH, std::ios::app);
-    if (!postWriter.is_open()) {
-        std::cerr << "Error: opening " << POSTS_FILE_PATH << " for appending." << std::endl;
+void FakeBook::parseAllFriends(){
+    ScopedTimer timer(Timer::ParseFriends);
+    if (masterUserList.empty()) {
+        std::cerr << "Cannot parse friends. User list is empty." << std::endl;
         return;
     }
-    std::string postId = newPost->getPostId();
-    std::string authorId = newPost->getAuthor()->getUserId();
-    std::string content = newPost->getContent();
-    bool isPublic = newPost->isPublic();
-    auto timestamp = newPost->getTimestamp();
-    long long timestampSeconds = std::chrono::duration_cast<std::chrono::seconds>(timestamp.time_since_epoch()).count();
+    MappedFile friendFile(FRIENDS_FILE_PATH);
+    if (!friendFile.isOpen()) {
+        std::cerr << "Error opening " << FRIENDS_FILE_PATH << " for reading." << std::endl;
+        return;
+    }
+    // the directory is only read while chunks are parsed, links are made afterwards in file order
+    std::vector<FriendChunk> chunks = parseInChunks<FriendChunk>(ingestPool.get(), friendFile.view(),
+        [this](std::string_view text, FriendChunk& chunk) { parseFriendChunk(userDirectory, text, chunk); });
 
-    postWriter << postId << "#" << authorId << "#"<< content << "#" <<
-        timestampSeconds << "#" << (isPublic ? "Public" : "FriendsOnly") << std::endl;
-    postWriter.close();
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    for (FriendChunk& chunk : chunks) {
+        std::cerr << chunk.warnings.str();
+        for (auto& [owner, friendUser] : chunk.links)
+            edges.emplace_back(owner->getGraphIndex(), friendUser->getGraphIndex());
+    }
+    int links = static_cast<int>(edges.size());
+    friendGraph.assignEdges(edges);
+    std::cout << "Successfully established " << links << " links." << std::endl;
 }
 
-void FakeBook::saveAllFriendsToFile() {
-    std::ofstream friendWriter(FRIENDS_FILE_PATH, std::ios::out);
-    if (!friendWriter) {
-        std::cerr << "Error opening " << FRIENDS_FILE_PATH << " for saving." << std::endl;
+void FakeBook::parseAllPosts() {
+    ScopedTimer timer(Timer::ParsePosts);
+    if (masterUserList.empty()) {
+        std::cerr << "Cannot parse posts. User list is empty. Run parseAllUsers() first." << std::endl;
         return;
     }
-    for (User* user : masterUserList) {
-        std::string line = user->getUserId() + ":";
-        std::list<User*> friends = user->getFriends();
+    MappedFile postFile(POSTS_FILE_PATH);
+    if (!postFile.isOpen()) {
+        std::cerr << "Error opening " << POSTS_FILE_PATH << " for reading." << std::endl;
+        return;
+    }
+    std::vector<PostChunk> chunks = parseInChunks<PostChunk>(ingestPool.get(), postFile.view(),
+        [this](std::string_view text, PostChunk& chunk) { parsePostChunk(userDirectory, text, chunk); });
 
-        for (User* friendUser : friends)
-            line += friendUser->getUserId() + ",";
+    size_t postCount = 0;
+    for (const PostChunk& chunk : chunks)
+        postCount += chunk.posts.size();
+    posts.reserve(postCount, postFile.view().size());
+    for (PostChunk& chunk : chunks) {
+        std::cerr << chunk.warnings.str();
+        for (const PostFields& fields : chunk.posts) {
+            uint32_t row = posts.append(fields.author, fields.postId, fields.content, fields.timestamp, fields.isPublic);
+            fields.author->addLoadedPost(row);
+        }
+    }
+    sortAllPostsByTime();
+    indexAllPosts();
+    std::cout << "Successfully loaded " << posts.size() << " posts into memory." << std::endl;
+}
 
-        if (line.back() == ',')
-            line.pop_back();
-        friendWriter << line << std::endl;
+void FakeBook::indexAllPosts() {
+    if (!options.searchIndexes)
+        return;
+    ScopedTimer timer(Timer::IndexPosts);
+    postIndex.build(posts, ingestPool.get());
+}
+
+// Feeds merge each author's posts in time order; sorting once after a bulk load is much cheaper
+// than keeping them ordered line by line.
+void FakeBook::sortAllPostsByTime() {
+    if (ingestPool == nullptr) {
+        for (User* user : masterUserList)
+            user->sortPostsByTime(posts);
+        return;
+    }
+    size_t sliceCount = ingestPool->size() * CHUNKS_PER_THREAD;
+    size_t sliceSize = masterUserList.size() / sliceCount + 1;
+    std::vector<std::future<void>> pending;
+    for (size_t begin = 0; begin < masterUserList.size(); begin += sliceSize) {
+        size_t end = std::min(begin + sliceSize, masterUserList.size());
+        pending.push_back(ingestPool->submit([this, begin, end]() {
+            for (size_t i = begin; i < end; ++i)
+                masterUserList[i]->sortPostsByTime(posts);
+        }));
     }
-    friendWriter.close();
+    for (std::future<void>& done : pending)
+        done.get();
 }
 
-void FakeBook::appendFriend() {
-    saveAllFriendsToFile();
-    std::cout << "Friendships saved to file." << std::endl;
+FakeBook::FakeBook(FakeBookOptions _options)
+    : options(_options),
+      userDirectory(strings),
+      recommender(friendGraph, _options.celebrityThreshold),
+      connections(friendGraph, _options.maxSeparation),
+      posts(friendGraph),
+      ids(_options.workerId),
+      friendRequests(ids),
+      timelines(posts, _options.feedCapacity, _options.celebrityThreshold),
+      auth(USERS_FILE_PATH, _options.readOnly ? 0 : std::max(1u, _options.hashThreads), _options.passwordIterations,
+           _options.maxQueuedLogins),
+      journal(JOURNAL_FILE_PATH, _options.readOnly) {
+    if (!options.metricsFile.empty()) {
+        Metrics::setEnabled(true);
+        metricsExporter = std::make_unique<MetricsExporter>(options.metricsFile, options.metricsIntervalSeconds);
+    }
+    unsigned threads = options.ingestThreads == 0 ? std::thread::hardware_concurrency() : options.ingestThreads;
+    if (threads > 1)
+        ingestPool = std::make_unique<ThreadPool>(threads);
+    loadAllData();
+    parseAllRequests();
+    replayJournal();
+    if (options.compactionIntervalSeconds > 0 && !options.readOnly)
+        compactionThread = std::thread(&FakeBook::compactionLoop, this);
 }
 
-void FakeBook::handleSendRequest() {
-    std::cout << "Enter username of person to send request to: ";
-    std::string username;
-    std::getline(std::cin, username);
+// The snapshot is only a cache of the text files: it is used when it was written after the last
+// change to any of them, otherwise the text files win.
+bool FakeBook::snapshotIsFresh() const {
+    std::error_code error;
+    auto snapshotTime = std::filesystem::last_write_time(SNAPSHOT_FILE_PATH, error);
+    if (error)
+        return false;
+    for (const std::string& path : {USERS_FILE_PATH, FRIENDS_FILE_PATH, POSTS_FILE_PATH}) {
+        auto textTime = std::filesystem::last_write_time(path, error);
+        if (!error && textTime >= snapshotTime)
+            return false;
+    }
+    return true;
+}
 
-    User* targetUser = usernameToPointer(username);
-    if (targetUser == nullptr) {
-        std::cout << "User not found." << std::endl;
-        return;
+void FakeBook::loadAllData() {
+    bool loaded = false;
+    if (options.useSnapshot && snapshotIsFresh()) {
+        loaded = loadSnapshot();
+        if (!loaded)
+            std::cerr << "Snapshot " << SNAPSHOT_FILE_PATH << " is unreadable, loading the text files instead." << std::endl;
     }
-    if (targetUser == currentSession) {
-        std::cout << "You can't send a friend request to yourself." << std::endl;
+    if (!loaded) {
+        parseAllUsers();
+        parseAllFriends();
+        parseAllPosts();
+    }
+    postsOnDisk = posts.size();
+    if (!options.searchIndexes)
         return;
+    ScopedTimer timer(Timer::IndexUsernames);
+    usernames.build(masterUserList);
+}
+
+bool FakeBook::loadSnapshot() {
+    ScopedTimer timer(Timer::LoadSnapshot);
+    SnapshotReader reader;
+    if (!reader.open(SNAPSHOT_FILE_PATH))
+        return false;
+
+    // strings and post content stay in the mapping, which is kept for as long as they are used
+    strings.borrow(reader.text());
+    strings.reserve(strings.size() + 4 * reader.userCount());
+    posts.borrow(reader.postContents(), reader.text());
+    std::vector<User*> loadedUsers;
+    loadedUsers.reserve(reader.userCount());
+    userArena.reserve(reader.userCount());
+    for (uint64_t i = 0; i < reader.userCount(); ++i) {
+        const SnapshotUser& record = reader.user(i);
+        SnapshotUserText text = reader.userText(record);
+        auto createdAt = std::chrono::system_clock::time_point(std::chrono::seconds(record.createdAt));
+        loadedUsers.push_back(userArena.create(strings, text.userName, text.userId, text.email, Credential::parse(text.password),
+                                               record.age, record.gender, text.location, record.isPublic != 0, createdAt));
+    }
+    // the snapshot's friend section is already CSR over the same user order
+    for (User* user : loadedUsers) {
+        friendGraph.addNode(user);
+        recommender.addUser(user);
+    }
+    std::vector<uint64_t> friendOffsets;
+    friendOffsets.reserve(reader.userCount() + 1);
+    const uint32_t* firstFriend = reader.userCount() > 0 ? reader.friendsBegin(0) : nullptr;
+    for (uint64_t i = 0; i < reader.userCount(); ++i)
+        friendOffsets.push_back(static_cast<uint64_t>(reader.friendsBegin(i) - firstFriend));
+    friendOffsets.push_back(reader.userCount() > 0 ? static_cast<uint64_t>(reader.friendsEnd(reader.userCount() - 1) - firstFriend) : 0);
+    int links = static_cast<int>(friendOffsets.back());
+    friendGraph.assign(std::move(friendOffsets), std::vector<uint32_t>(firstFriend, firstFriend + links));
+    posts.reserve(reader.postCount(), 0);
+    for (uint64_t i = 0; i < reader.postCount(); ++i) {
+        const SnapshotPost& record = reader.post(i);
+        SnapshotPostText text = reader.postText(record);
+        User* author = loadedUsers[record.authorIndex];
+        auto timeStamp = std::chrono::system_clock::time_point(std::chrono::seconds(record.timestamp));
+        author->addLoadedPost(posts.append(author, text.postId, text.content, timeStamp, record.isPublic != 0));
     }
+    for (User* user : loadedUsers) {
+        userDirectory.add(user);
+        masterUserList.push_back(user);
+    }
+    snapshotMapping = reader.takeMapping();
+    sortAllPostsByTime();
+    indexAllPosts();
+    std::cout << "Loaded snapshot: " << masterUserList.size() << " users, " << links << " links, "
+              << posts.size() << " posts." << std::endl;
+    return true;
+}
 
-    std::ofstream reqFile(REQUESTS_FILE_PATH, std::ios::app);
-    if (!reqFile) {
-        std::cerr << "Error opening requests file for appending." << std::endl;
+// The snapshot mirrors the base files, so the journal is folded into them first.
+void FakeBook::saveSnapshot() {
+    if (options.readOnly)
         return;
+    compactJournal();
+    SharedShardLock lock(stateLock, ShardedSharedMutex::threadKey());
+    ScopedTimer timer(Timer::SaveSnapshot);
+    if (writeSnapshot(SNAPSHOT_FILE_PATH, masterUserList, posts))
+        std::cout << "Snapshot saved to " << SNAPSHOT_FILE_PATH << "." << std::endl;
+}
+
+FakeBook::~FakeBook() {
+    if (compactionThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(compactionMutex);
+            stopCompaction = true;
+        }
+        compactionWake.notify_all();
+        compactionThread.join();
+    }
+}
+
+long long secondsSinceEpoch(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+}
+
+// postId#authorId#text#timestamp#visibility, the Posts.txt line without the newline
+std::string formatPostLine(const Post& post) {
+    std::ostringstream line;
+    post.writeLine(line);
+    return line.str();
+}
+
+// Writes to a temporary file and renames it over the original, so a crash mid-write never
+// leaves a half-written base file behind.
+bool replaceFile(const std::string& path, const std::function<void(std::ofstream&)>& write) {
+    std::string tempPath = path + ".tmp";
+    std::ofstream writer(tempPath, std::ios::out | std::ios::trunc);
+    if (!writer) {
+        std::cerr << "Error opening " << tempPath << " for saving." << std::endl;
+        return false;
+    }
+    write(writer);
+    writer.close();
+    if (!writer) {
+        std::cerr << "Error writing " << tempPath << "." << std::endl;
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::cerr << "Error replacing " << path << ": " << error.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Joins the fields of a journal record with '#'.
+std::string journalRecord(std::initializer_list<std::string_view> fields) {
+    std::string record;
+    for (std::string_view field : fields) {
+        if (!record.empty())
+            record.push_back('#');
+        record.append(field);
     }
+    return record;
+}
 
+uint32_t FakeBook::createPost(User* author, const PostDraft& draft) {
+    if (draft.content.find_first_of("#\n") != std::string::npos)
+        return NO_POST;
+    ScopedTimer timer(Timer::CreatePost);
     auto now = std::chrono::system_clock::now();
-    long long timestamp = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+    std::string postId = "p" + std::to_string(ids.next());
 
-    // Format: fromUserId#toUserId#timestamp#status
-    reqFile << currentSession->getUserId() << "#"
-            << targetUser->getUserId() << "#"
-            << timestamp << "#"
-            << "PENDING" << std::endl;
+    std::lock_guard<ShardedSharedMutex> lock(stateLock);
+    uint32_t row = posts.append(author, postId, draft.content, now, draft.isPublic);
+    author->addPost(posts, row);
+    timelines.onPostCreated(row);
+    postIndex.add(row, draft.content);
+    journal.append("POST#" + formatPostLine(posts.at(row)));
+    Metrics::count(Counter::PostsCreated);
+    return row;
+}
 
-    reqFile.close();
-    std::cout << "Friend request sent to " << username << "." << std::endl;
+// Replaces a legacy plaintext password, or a hash with an outdated work factor, after the user
+// logged in with it. Users.txt is rewritten at the next compaction. Needs stateLock exclusively.
+void FakeBook::upgradeCredential(User* user, Credential credential, bool logToJournal) {
+    user->setCredential(std::move(credential));
+    usersDirty = true;
+    if (logToJournal)
+        journal.append(journalRecord({"CREDENTIAL", user->getUserId(), user->getCredential().stored()}));
 }
 
-void FakeBook::handleRespondRequests() {
-    std::cout << "Loading your pending friend requests..." << std::endl;
-    std::ifstream reqFileIn(REQUESTS_FILE_PATH);
-    if (!reqFileIn) {
-        std::cout << "No pending requests." << std::endl;
+// Needs stateLock exclusively, as does removeFriendship.
+void FakeBook::addFriendship(User* user, User* newFriend, bool logToJournal) {
+    user->addFriend(newFriend);
+    newFriend->addFriend(user);
+    timelines.onFriendshipChanged(user, newFriend);
+    friendsDirty = true;
+    if (logToJournal)
+        journal.append(journalRecord({"FRIEND_ADD", user->getUserId(), newFriend->getUserId()}));
+}
+
+void FakeBook::removeFriendship(User* user, User* exFriend, bool logToJournal) {
+    user->removeFriend(exFriend);
+    exFriend->removeFriend(user);
+    timelines.onFriendshipChanged(user, exFriend);
+    friendsDirty = true;
+    if (logToJournal)
+        journal.append(journalRecord({"FRIEND_REMOVE", user->getUserId(), exFriend->getUserId()}));
+}
+
+// Returns false if the same request is already pending. Needs requestMutex under a shared
+// stateLock shard, or stateLock exclusively.
+bool FakeBook::addRequest(User* from, User* to, long long timestamp, bool logToJournal) {
+    if (!friendRequests.add(from, to, timestamp))
+        return false;
+    requestsDirty = true;
+    if (logToJournal)
+        journal.append(journalRecord({"REQUEST", from->getUserId(), to->getUserId(), std::to_string(timestamp)}));
+    return true;
+}
+
+// Moves the pending from -> to request to ACCEPTED or DECLINED. Accepting makes the two users
+// friends and also settles a crossed request the other way round. Declining needs the same locks
+// as addRequest; accepting needs stateLock exclusively.
+bool FakeBook::resolveRequest(User* from, User* to, bool accepted, bool logToJournal) {
+    RequestStatus newStatus = accepted ? RequestStatus::Accepted : RequestStatus::Declined;
+    if (!friendRequests.resolve(from, to, newStatus))
+        return false;
+    if (accepted)
+        friendRequests.resolve(to, from, newStatus);
+    requestsDirty = true;
+    if (logToJournal)
+        journal.append(journalRecord({"RESOLVE", from->getUserId(), to->getUserId(), requestStatusName(newStatus)}));
+    if (accepted && !to->hasFriend(from))
+        addFriendship(to, from, logToJournal);
+    return true;
+}
+
+void FakeBook::parseAllRequests() {
+    ScopedTimer timer(Timer::ParseRequests);
+    MappedFile requestFile(REQUESTS_FILE_PATH);
+    if (!requestFile.isOpen())
+        return; // no requests file yet just means no requests
+    std::string_view remaining = requestFile.view();
+    std::string_view line;
+    std::string_view fields[4];
+    requestsFoldedGeneration = 0;
+    requestsFoldedRecords = 0;
+    while (nextLine(remaining, line)) {
+        if (line.empty())
+            continue;
+        if (line.substr(0, 8) == "JOURNAL#") {
+            if (splitFields(line, '#', fields, 4) != 3 || !parseNumber(fields[1], requestsFoldedGeneration) ||
+                !parseNumber(fields[2], requestsFoldedRecords))
+                std::cerr << "Warning: Skipping malformed journal mark: " << line << std::endl;
+            continue;
+        }
+        long long timestamp = 0;
+        RequestStatus status;
+        if (splitFields(line, '#', fields, 4) != 4 || !parseNumber(fields[2], timestamp) ||
+            !parseRequestStatus(fields[3], status)) {
+            std::cerr << "Warning: Skipping malformed request line: " << line << std::endl;
+            continue;
+        }
+        User* from = idToPointer(fields[0]);
+        User* to = idToPointer(fields[1]);
+        if (from == nullptr || to == nullptr) {
+            std::cerr << "Warning: Skipping request between unknown users: " << line << std::endl;
+            continue;
+        }
+        if (!friendRequests.add(from, to, timestamp, status))
+            std::cerr << "Warning: Skipping duplicate pending request: " << line << std::endl;
+    }
+}
+
+// The flag is atomic, so a shared stateLock shard is enough.
+void FakeBook::applyPrivacy(User* user, bool isPublic, bool logToJournal) {
+    user->setPublic(isPublic);
+    usersDirty = true;
+    if (logToJournal)
+        journal.append(journalRecord({"PRIVACY", user->getUserId(), isPublic ? "Public" : "Private"}));
+}
+
+// Applies one journal record on top of the base files. A compaction that dies before truncating
+// the journal leaves records behind that the base files already hold. The friend, credential,
+// privacy and post records are idempotent, so they are simply applied again. Request records are
+// not: a request that was declined and then sent again would be added and declined once more. So
+// they are skipped when 'requestsFolded' says FriendRequests.txt already holds them.
+void FakeBook::replayJournalRecord(std::string_view record, bool requestsFolded) {
+    std::string_view fields[6];
+    size_t fieldCount = splitFields(record, '#', fields, 6);
+    std::string_view type = fields[0];
+    if ((type == "FRIEND_ADD" || type == "FRIEND_REMOVE") && fieldCount == 3) {
+        User* user = idToPointer(fields[1]);
+        User* other = idToPointer(fields[2]);
+        if (user == nullptr || other == nullptr)
+            return;
+        if (type == "FRIEND_ADD" && !user->hasFriend(other))
+            addFriendship(user, other, false);
+        else if (type == "FRIEND_REMOVE" && user->hasFriend(other))
+            removeFriendship(user, other, false);
+    } else if ((type == "REQUEST" || type == "RESOLVE") && requestsFolded) {
         return;
+    } else if (type == "REQUEST" && fieldCount == 4) {
+        User* from = idToPointer(fields[1]);
+        User* to = idToPointer(fields[2]);
+        long long timestamp = 0;
+        if (from == nullptr || to == nullptr || !parseNumber(fields[3], timestamp))
+            return;
+        addRequest(from, to, timestamp, false);
+    } else if (type == "RESOLVE" && fieldCount == 4) {
+        User* from = idToPointer(fields[1]);
+        User* to = idToPointer(fields[2]);
+        if (from != nullptr && to != nullptr)
+            resolveRequest(from, to, fields[3] == "ACCEPTED", false);
+    } else if (type == "CREDENTIAL" && fieldCount == 3) {
+        User* user = idToPointer(fields[1]);
+        if (user != nullptr)
+            upgradeCredential(user, Credential::parse(fields[2]), false);
+    } else if (type == "PRIVACY" && fieldCount == 3) {
+        User* user = idToPointer(fields[1]);
+        if (user != nullptr)
+            applyPrivacy(user, fields[2] == "Public", false);
+    } else if (type == "POST" && fieldCount == 6) {
+        if (posts.containsPostId(fields[1]))
+            return; // every loaded post ID is interned
+        PostChunk parsed;
+        parsePostChunk(userDirectory, record.substr(type.size() + 1), parsed);
+        std::cerr << parsed.warnings.str();
+        for (const PostFields& fields : parsed.posts) {
+            uint32_t row = posts.append(fields.author, fields.postId, fields.content, fields.timestamp, fields.isPublic);
+            fields.author->addPost(posts, row);
+            timelines.onPostCreated(row);
+            postIndex.add(row, fields.content);
+        }
+    } else {
+        std::cerr << "Warning: Skipping unknown journal record: " << record << std::endl;
     }
-    std::vector<std::string> remainingRequests;
-    std::string line;
-    bool foundRequests = false;
+}
 
-    while (std::getline(reqFileIn, line)) {
-        std::stringstream ss(line);
-        std::string segment;
-        std::vector<std::string> fields;
-        while (std::getline(ss, segment, '#')) {
-            fields.push_back(segment);
+void FakeBook::replayJournal() {
+    ScopedTimer timer(Timer::ReplayJournal);
+    size_t position = 0;
+    size_t folded = journal.getGeneration() == requestsFoldedGeneration ? requestsFoldedRecords : 0;
+    size_t replayed = journal.replay([&](std::string_view record) { replayJournalRecord(record, position++ < folded); });
+    if (replayed > 0)
+        std::cout << "Replayed " << replayed << " journal records." << std::endl;
+}
+
+// Folds the journal into the base files and truncates it. Runs with stateLock held exclusively,
+// so every record in the journal is already reflected in what gets written.
+void FakeBook::compactJournal() {
+    if (options.readOnly)
+        return;
+    std::lock_guard<ShardedSharedMutex> lock(stateLock);
+    if (journal.size() == 0)
+        return;
+    ScopedTimer timer(Timer::Compaction);
+    if (usersDirty && !saveAllUsersToFile())
+        return;
+    usersDirty = false;
+    if (friendsDirty && !saveAllFriendsToFile())
+        return;
+    friendsDirty = false;
+    if (requestsDirty && !saveAllRequestsToFile())
+        return;
+    requestsDirty = false;
+    if (postsOnDisk < posts.size()) {
+        std::ofstream postWriter(POSTS_FILE_PATH, std::ios::app);
+        if (!postWriter.is_open()) {
+            std::cerr << "Error: opening " << POSTS_FILE_PATH << " for appending." << std::endl;
+            return;
         }
-        if (fields.size() != 4 || fields[3] != "PENDING") {
-            remainingRequests.push_back(line);
-            continue;
+        for (uint32_t row = static_cast<uint32_t>(postsOnDisk); row < posts.size(); ++row) {
+            posts.at(row).writeLine(postWriter);
+            postWriter << '\n';
         }
+        postWriter.close();
+        if (!postWriter)
+            return;
+        postsOnDisk = posts.size();
+    }
+    journal.truncate();
+}
+
+void FakeBook::compactionLoop() {
+    std::unique_lock<std::mutex> lock(compactionMutex);
+    while (!stopCompaction) {
+        compactionWake.wait_for(lock, std::chrono::seconds(options.compactionIntervalSeconds), [this]() { return stopCompaction; });
+        if (stopCompaction)
+            break;
+        lock.unlock();
+        compactJournal();
+        lock.lock();
+    }
+}
+
+bool FakeBook::saveAllUsersToFile() {
+    ScopedTimer timer(Timer::SaveUsers);
+    return replaceFile(USERS_FILE_PATH, [this](std::ofstream& userWriter) {
+        for (User* user : masterUserList) {
+            user->writeUserLine(userWriter);
+            userWriter << '\n';
+        }
+    });
+}
+
+bool FakeBook::saveAllFriendsToFile() {
+    ScopedTimer timer(Timer::SaveFriends);
+    return replaceFile(FRIENDS_FILE_PATH, [this](std::ofstream& friendWriter) {
+        for (User* user : masterUserList) {
+            user->writeFriendLine(friendWriter);
+            friendWriter << '\n';
+        }
+    });
+}
+
+bool FakeBook::saveAllRequestsToFile() {
+    ScopedTimer timer(Timer::SaveRequests);
+    // Format: a JOURNAL#generation#records mark of the journal records folded in, then
+    // fromUserId#toUserId#timestamp#status lines
+    return replaceFile(REQUESTS_FILE_PATH, [this](std::ofstream& reqFile) {
+        reqFile << "JOURNAL#" << journal.getGeneration() << "#" << journal.size() << "\n";
+        for (const FriendRequest& request : friendRequests.all()) {
+            reqFile << request.from->getUserId() << "#" << request.to->getUserId() << "#"
+                    << request.timestamp << "#" << requestStatusName(request.status) << "\n";
+        }
+    });
+}
+
+// Only the lookup holds the lock; the slow hash runs unlocked on the Authenticator's pool.
+LoginResult FakeBook::login(std::string email, std::string password) {
+    if (options.readOnly)
+        return {};
+    ScopedTimer timer(Timer::Login);
+    std::future<LoginResult> pending;
+    {
+        SharedShardLock lock(stateLock, ShardedSharedMutex::threadKey());
+        pending = auth.authenticate(userDirectory, std::move(email), std::move(password));
+    }
+    LoginResult result = pending.get();
+    Metrics::count(result.busy ? Counter::LoginBusy : result.user != nullptr ? Counter::LoginSucceeded : Counter::LoginFailed);
+    if (result.user != nullptr && result.upgraded) {
+        std::lock_guard<ShardedSharedMutex> lock(stateLock);
+        upgradeCredential(result.user, std::move(*result.upgraded), true);
+        result.upgraded.reset();
+    }
+    return result;
+}
+
+User* FakeBook::signUp(const SignUpForm& form) {
+    if (options.readOnly)
+        return nullptr;
+    Credential credential = auth.hashPassword(form.password).get();
+    std::lock_guard<ShardedSharedMutex> lock(stateLock);
+    User* newUser = auth.signUp(form, std::move(credential), userArena, strings, ids, masterUserList, userDirectory);
+    if (newUser != nullptr) {
+        friendGraph.addNode(newUser);
+        recommender.addUser(newUser);
+        usernames.add(newUser);
+    }
+    return newUser;
+}
+
+// Sending a request only takes the sender's shard and requestMutex. Only when it crosses a
+// request the other way, and so makes a friendship, is it retried under the exclusive lock.
+RequestOutcome FakeBook::sendRequest(User* from, User* to) {
+    if (from == to)
+        return RequestOutcome::ToSelf;
+    long long timestamp = secondsSinceEpoch(std::chrono::system_clock::now());
+    {
+        SharedShardLock lock(stateLock, from->getGraphIndex());
+        std::lock_guard<std::mutex> requestLock(requestMutex);
+        if (from->hasFriend(to))
+            return RequestOutcome::AlreadyFriends;
+        if (!friendRequests.hasPending(to, from))
+            return addRequest(from, to, timestamp, true) ? RequestOutcome::Sent : RequestOutcome::AlreadySent;
+    }
+    std::lock_guard<ShardedSharedMutex> lock(stateLock);
+    if (from->hasFriend(to))
+        return RequestOutcome::AlreadyFriends;
+    if (resolveRequest(to, from, true, true))
+        return RequestOutcome::BecameFriends;
+    return addRequest(from, to, timestamp, true) ? RequestOutcome::Sent : RequestOutcome::AlreadySent;
+}
+
+std::vector<User*> FakeBook::pendingRequestsTo(const User* user) const {
+    SharedShardLock lock(stateLock, user->getGraphIndex());
+    std::lock_guard<std::mutex> requestLock(requestMutex);
+    return friendRequests.pendingSendersTo(user);
+}
 
-        std::string fromId = fields[0];
-        std::string toId = fields[1];
+bool FakeBook::respondToRequest(User* user, User* sender, bool accept) {
+    if (accept) {
+        std::lock_guard<ShardedSharedMutex> lock(stateLock);
+        return resolveRequest(sender, user, true, true);
+    }
+    SharedShardLock lock(stateLock, user->getGraphIndex());
+    std::lock_guard<std::mutex> requestLock(requestMutex);
+    return resolveRequest(sender, user, false, true);
+}
 
-        if (toId == currentSession->getUserId()) {
-            foundRequests = true;
-            User* sender = idToPointer(fromId);
-            if (sender == nullptr) {
-                std::cout << "A request from an unknown user was found and ignored." << std::endl;
+bool FakeBook::removeFriend(User* user, User* exFriend) {
+    std::lock_guard<ShardedSharedMutex> lock(stateLock);
+    if (!user->hasFriend(exFriend))
+        return false;
+    removeFriendship(user, exFriend, true);
+    return true;
+}
+
+FeedPage FakeBook::getFeed(User* user, size_t limit, const FeedCursor& cursor) {
+    ScopedTimer timer(Timer::FeedQuery);
+    SharedShardLock lock(stateLock, user->getGraphIndex());
+    FeedPage page = timelines.queryFeed(user, limit, cursor);
+    Metrics::count(Counter::FeedPostsServed, page.posts.size());
+    return page;
+}
+
+// Friends see every post, anyone else sees a public profile's public posts.
+ProfileView FakeBook::viewProfile(const User* viewer, const User* target) const {
+    SharedShardLock lock(stateLock, viewer->getGraphIndex());
+    ProfileView profile;
+    profile.user = target;
+    bool isFriend = viewer->hasFriend(target);
+    profile.fullAccess = target->isPublic() || isFriend;
+    if (profile.fullAccess)
+        profile.posts = isFriend ? target->postsByTime() : target->publicPostsByTime();
+    return profile;
+}
+
+// The same rule as viewProfile, post by post: the author and their friends see every post, anyone
+// else only the public posts of a public profile.
+SearchPage FakeBook::searchPosts(const User* viewer, std::string_view query, size_t limit, uint32_t before) const {
+    ScopedTimer timer(Timer::SearchPosts);
+    SharedShardLock lock(stateLock, viewer->getGraphIndex());
+    return postIndex.search(query, limit, before, [this, viewer](uint32_t row) {
+        const User* author = posts.author(row);
+        if (author == viewer)
+            return true;
+        if (posts.isPublic(row) && author->isPublic())
+            return true;
+        return viewer->hasFriend(author);
+    });
+}
+
+std::vector<Recommendation> FakeBook::recommendFriends(const User* user, size_t limit) const {
+    ScopedTimer timer(Timer::RecommendFriends);
+    SharedShardLock lock(stateLock, user->getGraphIndex());
+    return recommender.recommend(user, limit, options.recommendationWeights);
+}
+
+Connection FakeBook::findConnection(const User* user, const User* target) const {
+    ScopedTimer timer(Timer::FindConnection);
+    SharedShardLock lock(stateLock, user->getGraphIndex());
+    return connections.find(user, target);
+}
+
+GraphReport FakeBook::analyzeGraph() const {
+    SharedShardLock lock(stateLock, ShardedSharedMutex::threadKey());
+    return GraphAnalytics(friendGraph, ingestPool.get()).run();
+}
+
+// Chunks of users are ranked in parallel and written in Users.txt order as they finish, with a
+// bounded number in flight so memory stays flat at any scale. Holding one shard keeps writers
+// out for the workers too.
+bool FakeBook::saveRecommendations(const std::string& path, size_t limit) {
+    ScopedTimer timer(Timer::SaveRecommendations);
+    SharedShardLock lock(stateLock, ShardedSharedMutex::threadKey());
+    auto rankChunk = [this, limit](size_t begin, size_t end) {
+        std::string lines;
+        for (size_t i = begin; i < end; ++i) {
+            const User* user = masterUserList[i];
+            lines.append(user->getUserId());
+            lines.push_back(':');
+            std::vector<Recommendation> people = recommender.recommend(user, limit, options.recommendationWeights);
+            for (size_t j = 0; j < people.size(); ++j) {
+                if (j > 0)
+                    lines.push_back(',');
+                lines.append(people[j].user->getUserId());
+                lines.push_back('/');
+                lines.append(std::to_string(people[j].mutualFriends));
+            }
+            lines.push_back('\n');
+        }
+        return lines;
+    };
+    size_t userCount = masterUserList.size();
+    return replaceFile(path, [&](std::ofstream& writer) {
+        std::deque<std::future<std::string>> inFlight;
+        size_t window = ingestPool == nullptr ? 0 : ingestPool->size() * CHUNKS_PER_THREAD;
+        for (size_t begin = 0; begin < userCount; begin += RECOMMENDATION_CHUNK_USERS) {
+            size_t end = std::min(begin + RECOMMENDATION_CHUNK_USERS, userCount);
+            if (ingestPool == nullptr) {
+                writer << rankChunk(begin, end);
                 continue;
             }
-
-            std::cout << "\nFriend request from: " << sender->getUserName() << std::endl;
-            std::cout << "Accept (A), Decline (D), or Ignore (I)? ";
-            char choice;
-            std::cin >> choice;
-            clearCin();
-            choice = toupper(choice);
-
-            if (choice == 'A') {
-                currentSession->addFriend(sender);
-                sender->addFriend(currentSession);
-                appendFriend();
-                std::cout << "You are now friends with " << sender->getUserName() << "." << std::endl;
-            } else if (choice == 'D') {
-                std::cout << "Request declined." << std::endl;
-            } else {
-                remainingRequests.push_back(line);
+            inFlight.push_back(ingestPool->submit([&rankChunk, begin, end]() { return rankChunk(begin, end); }));
+            if (inFlight.size() >= window) {
+                writer << inFlight.front().get();
+                inFlight.pop_front();
             }
-        } else {
-            remainingRequests.push_back(line);
         }
+        for (std::future<std::string>& chunk : inFlight)
+            writer << chunk.get();
+    });
+}
+
+void FakeBook::setPrivacy(User* user, bool isPublic) {
+    SharedShardLock lock(stateLock, user->getGraphIndex());
+    applyPrivacy(user, isPublic, true);
+}
+
+void FakeBook::writePosts(std::ostream& out, std::string_view linePrefix, const std::vector<uint32_t>& rows) const {
+    SharedShardLock lock(stateLock, ShardedSharedMutex::threadKey());
+    for (uint32_t row : rows) {
+        out << linePrefix << posts.postId(row) << '#' << posts.author(row)->getUserName() << '#' << posts.content(row)
+            << '\n';
     }
-    reqFileIn.close();
+}
 
-    if (!foundRequests) {
+void FakeBook::shutdown() {
+    compactJournal();
+    if (options.useSnapshot && !snapshotIsFresh())
+        saveSnapshot();
+}
+
+void FakeBook::handleLogin() {
+    std::string email, password;
+    std::cout << "Enter email: ";
+    std::getline(std::cin, email);
+    std::cout << "Enter password: ";
+    std::getline(std::cin, password);
+
+    LoginResult result = login(std::move(email), std::move(password));
+    currentSession = result.user;
+    if (result.busy) {
+        std::cout << "Too many logins right now. Please try again in a moment." << std::endl;
+        return;
+    }
+    if (currentSession == nullptr) {
+        std::cout << "Login failed. Please check your email and password." << std::endl;
+        return;
+    }
+    std::cout << "Login successful! Welcome." << std::endl;
+}
+
+void FakeBook::handleSignUp() {
+    SignUpForm form = Authenticator::promptSignUp();
+    currentSession = signUp(form);
+    if (currentSession != nullptr) {
+        std::cout << "Sign up successful! You are now logged in." << std::endl;
+    } else {
+        std::cout << "Account already exits." << std::endl;
+    }
+}
+
+// Reads a username. Without an exact match, offers the closest ones to pick from; nullptr when
+// nothing is close or the user cancels.
+User* FakeBook::promptForUser(const std::string& prompt) {
+    std::cout << prompt;
+    std::string username;
+    std::getline(std::cin, username);
+    User* exact = usernameToPointer(username);
+    if (exact != nullptr)
+        return exact;
+
+    std::vector<UsernameMatch> matches = suggestUsernames(currentSession, username, USERNAME_SUGGESTIONS);
+    if (matches.empty()) {
+        std::cout << "User not found." << std::endl;
+        return nullptr;
+    }
+    std::cout << "No user named " << username << ". Did you mean:" << std::endl;
+    for (size_t i = 0; i < matches.size(); ++i) {
+        std::cout << i + 1 << ". " << matches[i].user->getUserName();
+        if (matches[i].isFriend)
+            std::cout << " (friend)";
+        else if (matches[i].mutualFriends > 0)
+            std::cout << " (" << matches[i].mutualFriends << " mutual friends)";
+        std::cout << std::endl;
+    }
+    std::cout << "Enter a number, or 0 to cancel: ";
+    size_t choice = 0;
+    if (!(std::cin >> choice)) {
+        std::cin.clear();
+        choice = 0;
+    }
+    clearCin();
+    if (choice == 0 || choice > matches.size())
+        return nullptr;
+    return matches[choice - 1].user;
+}
+
+void FakeBook::handleViewProfile() {
+    User* targetUser = promptForUser("Enter username to view: ");
+    if (targetUser)
+        currentSession->viewOtherProfile(viewProfile(currentSession, targetUser), posts);
+}
+
+void printRequestOutcome(RequestOutcome outcome, std::string_view username) {
+    switch (outcome) {
+        case RequestOutcome::ToSelf:
+            std::cout << "You can't send a friend request to yourself." << std::endl;
+            break;
+        case RequestOutcome::AlreadyFriends:
+            std::cout << "You are already friends with " << username << "." << std::endl;
+            break;
+        case RequestOutcome::BecameFriends:
+            std::cout << username << " had already sent you a request. You are now friends." << std::endl;
+            break;
+        case RequestOutcome::AlreadySent:
+            std::cout << "You already sent a friend request to " << username << "." << std::endl;
+            break;
+        case RequestOutcome::Sent:
+            std::cout << "Friend request sent to " << username << "." << std::endl;
+            break;
+    }
+}
+
+void FakeBook::handleSendRequest() {
+    User* targetUser = promptForUser("Enter username of person to send request to: ");
+    if (targetUser == nullptr)
+        return;
+    printRequestOutcome(sendRequest(currentSession, targetUser), targetUser->getUserName());
+}
+
+void FakeBook::handlePeopleYouMayKnow() {
+    std::vector<Recommendation> people = recommendFriends(currentSession, PEOPLE_YOU_MAY_KNOW);
+    if (people.empty()) {
+        std::cout << "No suggestions yet. Suggestions come from your friends' friends." << std::endl;
+        return;
+    }
+    std::cout << "\n--- People You May Know ---" << std::endl;
+    for (size_t i = 0; i < people.size(); ++i) {
+        std::cout << i + 1 << ". " << people[i].user->getUserName() << " (" << people[i].mutualFriends << " mutual friends";
+        if (people[i].sameLocation)
+            std::cout << ", also in " << people[i].user->getLocation();
+        std::cout << ")" << std::endl;
+    }
+    std::cout << "Send a friend request to (number, or 0 for none): ";
+    size_t choice = 0;
+    if (!(std::cin >> choice)) {
+        std::cin.clear();
+        choice = 0;
+    }
+    clearCin();
+    if (choice == 0 || choice > people.size())
+        return;
+    User* targetUser = people[choice - 1].user;
+    printRequestOutcome(sendRequest(currentSession, targetUser), targetUser->getUserName());
+}
+
+void FakeBook::handleFindConnection() {
+    User* targetUser = promptForUser("Enter username to find your connection to: ");
+    if (targetUser == nullptr)
+        return;
+    if (targetUser == currentSession) {
+        std::cout << "That's you." << std::endl;
+        return;
+    }
+    Connection connection = findConnection(currentSession, targetUser);
+    if (connection.path.empty()) {
+        std::cout << "You and " << targetUser->getUserName() << " aren't connected within " << options.maxSeparation
+                  << " friendships." << std::endl;
+    } else {
+        std::cout << "You and " << targetUser->getUserName() << " are " << connection.path.size() - 1
+                  << (connection.path.size() == 2 ? " friendship" : " friendships") << " apart:" << std::endl;
+        for (size_t i = 0; i < connection.path.size(); ++i)
+            std::cout << (i == 0 ? "  " : " -> ") << connection.path[i]->getUserName();
+        std::cout << std::endl;
+    }
+    std::cout << "Mutual friends (" << connection.mutualFriends.size() << ")";
+    for (size_t i = 0; i < connection.mutualFriends.size() && i < MUTUAL_FRIENDS_SHOWN; ++i)
+        std::cout << (i == 0 ? ": " : ", ") << connection.mutualFriends[i]->getUserName();
+    if (connection.mutualFriends.size() > MUTUAL_FRIENDS_SHOWN)
+        std::cout << ", ...";
+    std::cout << std::endl;
+}
+
+void FakeBook::handleViewFeed() {
+    std::cout << "Building your home feed..." << std::endl;
+    FeedCursor cursor;
+    for (size_t pageNumber = 1;; ++pageNumber) {
+        FeedPage page = getFeed(currentSession, options.feedPageSize, cursor);
+        currentSession->viewFeed(posts, page.posts, pageNumber);
+        if (!page.hasMore)
+            return;
+
+        std::cout << "Show more posts? (Y/N) ";
+        char choice;
+        std::cin >> choice;
+        clearCin();
+        if (toupper(choice) != 'Y')
+            return;
+        cursor = page.next;
+    }
+}
+
+void FakeBook::handleRespondRequests() {
+    std::cout << "Loading your pending friend requests..." << std::endl;
+    std::vector<User*> senders = pendingRequestsTo(currentSession);
+    if (senders.empty()) {
         std::cout << "You have no pending friend requests." << std::endl;
+        return;
     }
-    std::ofstream reqFileOut(REQUESTS_FILE_PATH, std::ios::out);
-    for (const std::string& req : remainingRequests) {
-        reqFileOut << req << std::endl;
+
+    for (User* sender : senders) {
+        std::cout << "\nFriend request from: " << sender->getUserName() << std::endl;
+        std::cout << "Accept (A), Decline (D), or Ignore (I)? ";
+        char choice;
+        std::cin >> choice;
+        clearCin();
+        choice = toupper(choice);
+
+        if (choice == 'A') {
+            respondToRequest(currentSession, sender, true);
+            std::cout << "You are now friends with " << sender->getUserName() << "." << std::endl;
+        } else if (choice == 'D') {
+            respondToRequest(currentSession, sender, false);
+            std::cout << "Request declined." << std::endl;
+        }
     }
-    reqFileOut.close();
 }
 
 void FakeBook::handleRemoveFriend() {
     std::cout << "Your current friends:" << std::endl;
-    std::list<User*> friends = currentSession->getFriends();
+    FriendGraph::FriendRange friends = currentSession->getFriends();
     if (friends.empty()) {
         std::cout << "You have no friends to remove." << std::endl;
         return;
@@ -331,39 +1149,53 @@ void FakeBook::handleRemoveFriend() {
     for (User* f : friends) {
         std::cout << "- " << f->getUserName() << std::endl;
     }
-    std::cout << "\nEnter username of friend to remove: ";
-    std::string username;
-    std::getline(std::cin, username);
+    User* targetUser = promptForUser("\nEnter username of friend to remove: ");
+    if (targetUser == nullptr)
+        return;
+    std::string_view username = targetUser->getUserName();
 
-    User* targetUser = usernameToPointer(username);
-    if (targetUser == nullptr) {
-        std::cout << "User not found." << std::endl;
+    if (!removeFriend(currentSession, targetUser)) {
+        std::cout << "That user is not on your friends list." << std::endl;
         return;
     }
+    std::cout << "Removed " << username << " from your friends list." << std::endl;
+}
 
-    bool isFriend = false;
-    for (User* f : friends) {
-        if (f == targetUser) {
-            isFriend = true;
-            break;
+void FakeBook::handleSearchPosts() {
+    std::cout << "Search for (words, or \"an exact phrase\"): ";
+    std::string query;
+    std::getline(std::cin, query);
+    uint32_t before = UINT32_MAX;
+    for (size_t pageNumber = 1;; ++pageNumber) {
+        SearchPage page = searchPosts(currentSession, query, options.feedPageSize, before);
+        if (page.posts.empty()) {
+            std::cout << (pageNumber == 1 ? "No posts found." : "No more posts.") << std::endl;
+            return;
         }
-    }
+        std::cout << "\n--- Posts matching \"" << query << "\", most recently loaded first, page " << pageNumber << " ---"
+                  << std::endl;
+        for (uint32_t row : page.posts) {
+            std::cout << "--------------------" << std::endl;
+            std::cout << "Post by: " << posts.author(row)->getUserName() << std::endl;
+            std::cout << posts.content(row) << std::endl;
+        }
+        std::cout << "--------------------" << std::endl;
+        if (!page.hasMore)
+            return;
 
-    if (!isFriend) {
-        std::cout << "That user is not on your friends list." << std::endl;
-        return;
+        std::cout << "Show more posts? (Y/N) ";
+        char choice;
+        std::cin >> choice;
+        clearCin();
+        if (toupper(choice) != 'Y')
+            return;
+        before = page.next;
     }
-    currentSession->removeFriend(targetUser);
-    targetUser->removeFriend(currentSession);
-
-    appendFriend();
-    std::cout << "Removed " << username << " from your friends list." << std::endl;
 }
 
 void FakeBook::runFakeBook() {
     bool isRunning = true;
     int choice = 0;
-    Authenticator auth("DataStorage/Users.txt");
     do {
         if (currentSession == nullptr) {
             std::cout << "\n============================= Welcome to FakeBook ==============================" << std::endl;
@@ -371,6 +1203,7 @@ void FakeBook::runFakeBook() {
             std::cout << "1. Login" << std::endl;
             std::cout << "2. Sign Up" << std::endl;
             std::cout << "3. Quit" << std::endl;
+            std::cout << "4. Save Snapshot" << std::endl;
             std::cout << "Enter your choice: ";
 
             if (!(std::cin >> choice)) {
@@ -382,40 +1215,58 @@ void FakeBook::runFakeBook() {
             clearCin();
             switch (choice) {
                 case 0: {
-                    std::cout << "Generating dummy data... This may take a moment." << std::endl;
-                    DummyDataGenerator generator;
-                    generator.populateUsers();
-                    generator.populateFriendsAndRequests();
-                    generator.populatePosts();
-                    std::cout << "Dummy data generation complete!" << std::endl;
-
-                    std::cout << "Reloading all data..." << std::endl;
-                    masterUserList.clear();
-                    masterPostList.clear();
-                    parseAllUsers();
-                    parseAllFriends();
-                    parseAllPosts();
+                    {
+                        // The generator replaces every base file, so pending journal records and
+                        // dirty state are stale. The lock keeps compaction from writing the old
+                        // state over the new files until the reload is done.
+                        std::lock_guard<ShardedSharedMutex> lock(stateLock);
+                        journal.truncate();
+                        usersDirty = false;
+                        friendsDirty = false;
+                        requestsDirty = false;
+                        postsOnDisk = posts.size(); // nothing left to append to Posts.txt
+
+                        std::cout << "Generating dummy data... This may take a moment." << std::endl;
+                        DummyDataGenerator generator;
+                        generator.populateUsers();
+                        generator.populateFriendsAndRequests();
+                        generator.populatePosts();
+                        std::cout << "Dummy data generation complete!" << std::endl;
+
+                        std::cout << "Reloading all data..." << std::endl;
+                        // nothing may point into the arenas once they are cleared
+                        masterUserList.clear();
+                        userDirectory.clear();
+                        usernames.clear();
+                        friendGraph.clear();
+                        recommender.clear();
+                        friendRequests.clear();
+                        timelines.clear();
+                        postIndex.clear();
+                        posts.clear();
+                        userArena.clear();
+                        strings.clear();
+                        snapshotMapping = MappedFile();
+                        loadAllData();
+                        parseAllRequests();
+                    }
                     std::cout << "Data reloaded." << std::endl;
                     break;
                 }
                 case 1:
-                    currentSession = auth.login(masterUserList);
-                    if (currentSession == nullptr)
-                        std::cout << "Login failed. Please check your email and password." << std::endl;
-                     else
-                        std::cout << "Login successful! Welcome." << std::endl;
+                    handleLogin();
                     break;
                 case 2:
-                    currentSession = auth.signUp(masterUserList);
-                    if (currentSession != nullptr)
-                        std::cout << "Sign up successful! You are now logged in." << std::endl;
-                    else
-                        std::cout << "Account already exits." << std::endl;
+                    handleSignUp();
                     break;
                 case 3:
                     isRunning = false;
+                    shutdown();
                     std::cout << "Terminating FakeBook.exe" << std::endl;
                     break;
+                case 4:
+                    saveSnapshot();
+                    break;
                 default:
                     std::cout << "Invalid choice. Please try again." << std::endl;
                     break;
@@ -431,6 +1282,9 @@ void FakeBook::runFakeBook() {
             std::cout << "7. Remove Friend" << std::endl;
             std::cout << "8. Change Privacy Setting" << std::endl;
             std::cout << "9. Logout" << std::endl;
+            std::cout << "10. Search Posts" << std::endl;
+            std::cout << "11. People You May Know" << std::endl;
+            std::cout << "12. How Am I Connected?" << std::endl;
             std::cout << "Enter your choice: ";
             if (!(std::cin >> choice)) {
                 std::cerr << "Invalid input. Please enter a number." << std::endl;
@@ -442,31 +1296,20 @@ void FakeBook::runFakeBook() {
 
             switch (choice) {
                 case 1:
-                    currentSession->viewFeed();
+                    handleViewFeed();
                     break;
                 case 2:
-                    currentSession->viewOwnProfile();
+                    currentSession->viewOwnProfile(posts);
                     break;
-                case 3: {
-                    std::cout << "Enter username to view: ";
-                    std::string username;
-                    std::getline(std::cin, username);
-                    User* targetUser = usernameToPointer(username);
-                    if (targetUser) {
-                        currentSession->viewOtherProfile(targetUser);
-                    } else {
-                        std::cout << "User not found." << std::endl;
-                    }
+                case 3:
+                    handleViewProfile();
                     break;
-                }
-                case 4: {
-                    Post* newPost = currentSession->createPost();
-                    if (newPost) {
-                        masterPostList.push_back(newPost);
-                        appendPost(newPost);
-                    }
+                case 4:
+                    if (createPost(currentSession, currentSession->promptNewPost()) == NO_POST)
+                        std::cout << "Posts can't contain '#'." << std::endl;
+                    else
+                        std::cout << "Post created successfully!" << std::endl;
                     break;
-                }
                 case 5:
                     handleSendRequest();
                     break;
@@ -477,12 +1320,22 @@ void FakeBook::runFakeBook() {
                     handleRemoveFriend();
                     break;
                 case 8:
-                    currentSession->changePrivacySetting();
+                    setPrivacy(currentSession, currentSession->promptPrivacySetting());
+                    std::cout << "Your profile is now " << (currentSession->isPublic() ? "Public." : "Private.") << std::endl;
                     break;
                 case 9:
                     currentSession = nullptr;
                     std::cout << "You have been logged out." << std::endl;
                     break;
+                case 10:
+                    handleSearchPosts();
+                    break;
+                case 11:
+                    handlePeopleYouMayKnow();
+                    break;
+                case 12:
+                    handleFindConnection();
+                    break;
                 default:
                     std::cout << "Invalid choice. Please try again." << std::endl;
                     break;
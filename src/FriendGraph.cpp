@@ -0,0 +1,289 @@
+#include "FriendGraph.h"
+#include "User.h"
+#include <algorithm>
+#include <iterator>
+
+// Rows at least this long, and dense enough that a bitset over all nodes is no bigger than the
+// row itself, get O(1) membership tests.
+const size_t BITSET_MIN_DEGREE = 64;
+const size_t MIN_MERGE_OVERLAY = 1024;
+
+bool insertSorted(std::vector<uint32_t>& values, uint32_t value) {
+    auto it = std::lower_bound(values.begin(), values.end(), value);
+    if (it != values.end() && *it == value)
+        return false;
+    values.insert(it, value);
+    return true;
+}
+
+bool eraseSorted(std::vector<uint32_t>& values, uint32_t value) {
+    auto it = std::lower_bound(values.begin(), values.end(), value);
+    if (it == values.end() || *it != value)
+        return false;
+    values.erase(it);
+    return true;
+}
+
+uint32_t FriendGraph::addNode(User* user) {
+    uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(user);
+    offsets.push_back(offsets.back());
+    bitsetSlot.push_back(-1);
+    user->attachToGraph(this, index);
+    return index;
+}
+
+void FriendGraph::assign(std::vector<uint64_t> rowOffsets, std::vector<uint32_t> rowNeighbours) {
+    // sort and deduplicate each row, compacting the array in place
+    uint64_t write = 0;
+    for (size_t node = 0; node + 1 < rowOffsets.size(); ++node) {
+        auto first = rowNeighbours.begin() + static_cast<std::ptrdiff_t>(rowOffsets[node]);
+        auto last = rowNeighbours.begin() + static_cast<std::ptrdiff_t>(rowOffsets[node + 1]);
+        if (!std::is_sorted(first, last))
+            std::sort(first, last);
+        last = std::unique(first, last);
+        uint64_t rowLength = static_cast<uint64_t>(last - first);
+        if (write != rowOffsets[node])
+            std::copy(first, last, rowNeighbours.begin() + static_cast<std::ptrdiff_t>(write));
+        rowOffsets[node] = write;
+        write += rowLength;
+    }
+    rowOffsets.back() = write;
+    rowNeighbours.resize(write);
+
+    offsets = std::move(rowOffsets);
+    neighbours = std::move(rowNeighbours);
+    overlays.clear();
+    overlayEntries = 0;
+    buildBitsets();
+}
+
+// Counting sort of (from, to) pairs into rows.
+void FriendGraph::assignEdges(const std::vector<std::pair<uint32_t, uint32_t>>& edges) {
+    std::vector<uint64_t> rowOffsets(nodes.size() + 1, 0);
+    for (const auto& edge : edges)
+        ++rowOffsets[edge.first + 1];
+    for (size_t i = 1; i < rowOffsets.size(); ++i)
+        rowOffsets[i] += rowOffsets[i - 1];
+
+    std::vector<uint32_t> rowNeighbours(edges.size());
+    std::vector<uint64_t> fill(rowOffsets.begin(), rowOffsets.end() - 1);
+    for (const auto& edge : edges)
+        rowNeighbours[fill[edge.first]++] = edge.second;
+    assign(std::move(rowOffsets), std::move(rowNeighbours));
+}
+
+void FriendGraph::clear() {
+    nodes.clear();
+    offsets.assign(1, 0);
+    neighbours.clear();
+    bitsetSlot.clear();
+    bitsets.clear();
+    overlays.clear();
+    overlayEntries = 0;
+}
+
+size_t FriendGraph::edgeCount() const {
+    size_t count = neighbours.size();
+    for (const auto& [node, overlay] : overlays)
+        count = count + overlay.added.size() - overlay.removed.size();
+    return count;
+}
+
+void FriendGraph::buildBitsets() {
+    bitsets.clear();
+    bitsetSlot.assign(nodes.size(), -1);
+    size_t words = (nodes.size() + 63) / 64;
+    for (uint32_t node = 0; node < nodes.size(); ++node) {
+        size_t rowLength = offsets[node + 1] - offsets[node];
+        if (rowLength < BITSET_MIN_DEGREE || rowLength * 32 < nodes.size())
+            continue;
+        bitsetSlot[node] = static_cast<int32_t>(bitsets.size());
+        std::vector<uint64_t>& bits = bitsets.emplace_back(words, 0);
+        for (uint64_t i = offsets[node]; i < offsets[node + 1]; ++i)
+            bits[neighbours[i] / 64] |= uint64_t{1} << (neighbours[i] % 64);
+    }
+}
+
+bool FriendGraph::inBaseRow(uint32_t from, uint32_t to) const {
+    if (bitsetSlot[from] >= 0) {
+        const std::vector<uint64_t>& bits = bitsets[bitsetSlot[from]];
+        return to / 64 < bits.size() && ((bits[to / 64] >> (to % 64)) & 1);
+    }
+    const uint32_t* first = neighbours.data() + offsets[from];
+    const uint32_t* last = neighbours.data() + offsets[from + 1];
+    return std::binary_search(first, last, to);
+}
+
+std::pair<const uint32_t*, const uint32_t*> FriendGraph::sortedRow(uint32_t node, std::vector<uint32_t>& scratch) const {
+    const uint32_t* first = neighbours.data() + offsets[node];
+    const uint32_t* last = neighbours.data() + offsets[node + 1];
+    auto it = overlays.empty() ? overlays.end() : overlays.find(node);
+    if (it == overlays.end())
+        return {first, last};
+    scratch.clear();
+    std::set_difference(first, last, it->second.removed.begin(), it->second.removed.end(), std::back_inserter(scratch));
+    size_t kept = scratch.size();
+    scratch.insert(scratch.end(), it->second.added.begin(), it->second.added.end());
+    std::inplace_merge(scratch.begin(), scratch.begin() + static_cast<std::ptrdiff_t>(kept), scratch.end());
+    return {scratch.data(), scratch.data() + scratch.size()};
+}
+
+// Calls 'visit' for every node in both sorted rows, in order: a linear merge, or binary searches
+// into the longer row when it is more than 16 times longer, as for a celebrity and an ordinary user.
+template <typename Visit>
+void forEachCommonNeighbour(const uint32_t* aFirst, const uint32_t* aLast, const uint32_t* bFirst, const uint32_t* bLast,
+                            Visit&& visit) {
+    if (aLast - aFirst > bLast - bFirst) {
+        std::swap(aFirst, bFirst);
+        std::swap(aLast, bLast);
+    }
+    if ((aLast - aFirst) * 16 < bLast - bFirst) {
+        for (const uint32_t* node = aFirst; node != aLast; ++node) {
+            if (std::binary_search(bFirst, bLast, *node))
+                visit(*node);
+        }
+        return;
+    }
+    while (aFirst != aLast && bFirst != bLast) {
+        if (*aFirst < *bFirst) {
+            ++aFirst;
+        } else if (*bFirst < *aFirst) {
+            ++bFirst;
+        } else {
+            visit(*aFirst);
+            ++aFirst;
+            ++bFirst;
+        }
+    }
+}
+
+size_t FriendGraph::commonNeighbourCount(uint32_t a, uint32_t b) const {
+    std::vector<uint32_t> scratchA, scratchB;
+    auto [aFirst, aLast] = sortedRow(a, scratchA);
+    auto [bFirst, bLast] = sortedRow(b, scratchB);
+    size_t common = 0;
+    forEachCommonNeighbour(aFirst, aLast, bFirst, bLast, [&common](uint32_t) { ++common; });
+    return common;
+}
+
+std::vector<uint32_t> FriendGraph::commonNeighbours(uint32_t a, uint32_t b) const {
+    std::vector<uint32_t> scratchA, scratchB, common;
+    auto [aFirst, aLast] = sortedRow(a, scratchA);
+    auto [bFirst, bLast] = sortedRow(b, scratchB);
+    forEachCommonNeighbour(aFirst, aLast, bFirst, bLast, [&common](uint32_t node) { common.push_back(node); });
+    return common;
+}
+
+bool FriendGraph::addEdge(uint32_t from, uint32_t to) {
+    auto it = overlays.find(from);
+    if (it != overlays.end() && eraseSorted(it->second.removed, to)) {
+        --overlayEntries;
+        if (it->second.added.empty() && it->second.removed.empty())
+            overlays.erase(it);
+        return true;
+    }
+    if (inBaseRow(from, to))
+        return false;
+    if (!insertSorted(overlays[from].added, to))
+        return false;
+    ++overlayEntries;
+    mergeIfLarge();
+    return true;
+}
+
+bool FriendGraph::removeEdge(uint32_t from, uint32_t to) {
+    auto it = overlays.find(from);
+    if (it != overlays.end() && eraseSorted(it->second.added, to)) {
+        --overlayEntries;
+        if (it->second.added.empty() && it->second.removed.empty())
+            overlays.erase(it);
+        return true;
+    }
+    if (!inBaseRow(from, to))
+        return false;
+    if (!insertSorted(overlays[from].removed, to))
+        return false;
+    ++overlayEntries;
+    mergeIfLarge();
+    return true;
+}
+
+bool FriendGraph::hasEdge(uint32_t from, uint32_t to) const {
+    if (!overlays.empty()) {
+        auto it = overlays.find(from);
+        if (it != overlays.end()) {
+            if (std::binary_search(it->second.added.begin(), it->second.added.end(), to))
+                return true;
+            if (std::binary_search(it->second.removed.begin(), it->second.removed.end(), to))
+                return false;
+        }
+    }
+    return inBaseRow(from, to);
+}
+
+size_t FriendGraph::degree(uint32_t node) const {
+    size_t count = offsets[node + 1] - offsets[node];
+    if (!overlays.empty()) {
+        auto it = overlays.find(node);
+        if (it != overlays.end())
+            count = count + it->second.added.size() - it->second.removed.size();
+    }
+    return count;
+}
+
+FriendGraph::FriendRange FriendGraph::friendsOf(uint32_t node) const {
+    const uint32_t* base = neighbours.data() + offsets[node];
+    const uint32_t* baseEnd = neighbours.data() + offsets[node + 1];
+    const uint32_t* removed = nullptr;
+    const uint32_t* removedEnd = nullptr;
+    const uint32_t* added = nullptr;
+    const uint32_t* addedEnd = nullptr;
+    if (!overlays.empty()) {
+        auto it = overlays.find(node);
+        if (it != overlays.end()) {
+            removed = it->second.removed.data();
+            removedEnd = removed + it->second.removed.size();
+            added = it->second.added.data();
+            addedEnd = added + it->second.added.size();
+        }
+    }
+    FriendRange::iterator first(base, baseEnd, removed, removedEnd, added, nodes.data());
+    FriendRange::iterator last(baseEnd, baseEnd, removedEnd, removedEnd, addedEnd, nodes.data());
+    return FriendRange(first, last, degree(node));
+}
+
+void FriendGraph::mergeIfLarge() {
+    if (overlayEntries > std::max(MIN_MERGE_OVERLAY, neighbours.size() / 16))
+        mergeOverlays();
+}
+
+// Rebuilds the CSR arrays with every overlay applied. O(nodes + edges).
+void FriendGraph::mergeOverlays() {
+    if (overlays.empty())
+        return;
+    std::vector<uint64_t> mergedOffsets;
+    mergedOffsets.reserve(offsets.size());
+    std::vector<uint32_t> merged;
+    merged.reserve(edgeCount());
+    mergedOffsets.push_back(0);
+    std::vector<uint32_t> kept;
+    for (uint32_t node = 0; node < nodes.size(); ++node) {
+        const uint32_t* first = neighbours.data() + offsets[node];
+        const uint32_t* last = neighbours.data() + offsets[node + 1];
+        auto it = overlays.find(node);
+        if (it == overlays.end()) {
+            merged.insert(merged.end(), first, last);
+        } else {
+            kept.clear();
+            std::set_difference(first, last, it->second.removed.begin(), it->second.removed.end(), std::back_inserter(kept));
+            std::merge(kept.begin(), kept.end(), it->second.added.begin(), it->second.added.end(), std::back_inserter(merged));
+        }
+        mergedOffsets.push_back(merged.size());
+    }
+    offsets = std::move(mergedOffsets);
+    neighbours = std::move(merged);
+    overlays.clear();
+    overlayEntries = 0;
+    buildBitsets();
+}
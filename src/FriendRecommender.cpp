@@ -0,0 +1,127 @@
+#include "FriendRecommender.h"
+#include "FriendGraph.h"
+#include "User.h"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+
+const uint32_t NOT_A_CANDIDATE = UINT32_MAX;
+
+// The count's working space, per thread and reused like the feed merge's FeedScratch.
+struct RecommendScratch {
+    std::vector<uint32_t> mutualCounts; // per graph node: 0, a count, or NOT_A_CANDIDATE for the user and their friends
+    std::vector<uint32_t> candidates;   // nodes with a count, in first-seen order
+    std::vector<uint32_t> hubs;
+    std::vector<uint32_t> userRow;
+    std::vector<uint32_t> friendRow;
+    std::vector<uint64_t> best; // min-heap of recommendationRankKey()s
+};
+
+RecommendScratch& recommendScratch() {
+    thread_local RecommendScratch scratch;
+    return scratch;
+}
+
+// Higher is better: the score, then the lower graph index.
+uint64_t recommendationRankKey(uint32_t score, uint32_t node) {
+    return static_cast<uint64_t>(score) << 32 | (UINT32_MAX - node);
+}
+
+FriendRecommender::FriendRecommender(const FriendGraph& _graph, size_t _hubDegree) : graph(_graph), hubDegree(_hubDegree) {
+}
+
+void FriendRecommender::addUser(const User* user) {
+    profiles.push_back(static_cast<uint64_t>(user->getLocationKey()) << 32 | static_cast<uint32_t>(user->getAge()));
+}
+
+void FriendRecommender::clear() {
+    profiles.clear();
+}
+
+std::vector<Recommendation> FriendRecommender::recommend(const User* user, size_t limit,
+                                                         const RecommendationWeights& weights) const {
+    std::vector<Recommendation> page;
+    if (limit == 0)
+        return page;
+    RecommendScratch& scratch = recommendScratch();
+    if (scratch.mutualCounts.size() < graph.nodeCount())
+        scratch.mutualCounts.resize(graph.nodeCount(), 0);
+    uint32_t* counts = scratch.mutualCounts.data();
+    uint32_t self = user->getGraphIndex();
+    auto [friendsFirst, friendsLast] = graph.sortedRow(self, scratch.userRow);
+    counts[self] = NOT_A_CANDIDATE;
+    for (const uint32_t* node = friendsFirst; node != friendsLast; ++node)
+        counts[*node] = NOT_A_CANDIDATE;
+
+    scratch.candidates.clear();
+    scratch.hubs.clear();
+    auto expand = [&](uint32_t friendNode) {
+        auto [first, last] = graph.sortedRow(friendNode, scratch.friendRow);
+        for (; first != last; ++first) {
+            uint32_t& count = counts[*first];
+            if (count == NOT_A_CANDIDATE)
+                continue;
+            if (count++ == 0)
+                scratch.candidates.push_back(*first);
+        }
+    };
+    for (const uint32_t* node = friendsFirst; node != friendsLast; ++node) {
+        if (graph.degree(*node) > hubDegree)
+            scratch.hubs.push_back(*node);
+        else
+            expand(*node);
+    }
+    bool countsExact = scratch.hubs.empty();
+    if (scratch.candidates.size() < limit) {
+        for (uint32_t hub : scratch.hubs)
+            expand(hub);
+        countsExact = true;
+    }
+
+    uint64_t ownProfile = profiles[self];
+    auto describe = [&](uint32_t node, uint32_t mutualFriends) {
+        Recommendation recommendation;
+        recommendation.mutualFriends = mutualFriends;
+        recommendation.sameLocation = profiles[node] >> 32 == ownProfile >> 32;
+        int ageGap = static_cast<int>(static_cast<uint32_t>(profiles[node])) - static_cast<int>(static_cast<uint32_t>(ownProfile));
+        recommendation.closeInAge = std::abs(ageGap) <= weights.ageBand;
+        recommendation.score = mutualFriends * weights.perMutualFriend +
+                               (recommendation.sameLocation ? weights.sameLocation : 0) +
+                               (recommendation.closeInAge ? weights.closeInAge : 0);
+        return recommendation;
+    };
+    // only candidates whose best possible score could still get in are described
+    std::vector<uint64_t>& best = scratch.best;
+    best.clear();
+    uint32_t bonuses = weights.sameLocation + weights.closeInAge;
+    for (uint32_t node : scratch.candidates) {
+        uint32_t mutualFriends = counts[node];
+        if (best.size() == limit && recommendationRankKey(mutualFriends * weights.perMutualFriend + bonuses, node) <= best.front())
+            continue;
+        uint64_t key = recommendationRankKey(describe(node, mutualFriends).score, node);
+        if (best.size() < limit) {
+            best.push_back(key);
+            std::push_heap(best.begin(), best.end(), std::greater<uint64_t>());
+        } else if (key > best.front()) {
+            std::pop_heap(best.begin(), best.end(), std::greater<uint64_t>());
+            best.back() = key;
+            std::push_heap(best.begin(), best.end(), std::greater<uint64_t>());
+        }
+    }
+    for (uint64_t key : best) {
+        uint32_t node = UINT32_MAX - static_cast<uint32_t>(key);
+        uint32_t mutualFriends = countsExact ? counts[node] : static_cast<uint32_t>(graph.commonNeighbourCount(self, node));
+        page.push_back(describe(node, mutualFriends));
+        page.back().user = graph.nodeAt(node);
+    }
+    std::sort(page.begin(), page.end(), [](const Recommendation& a, const Recommendation& b) {
+        return recommendationRankKey(a.score, a.user->getGraphIndex()) > recommendationRankKey(b.score, b.user->getGraphIndex());
+    });
+
+    for (uint32_t node : scratch.candidates)
+        counts[node] = 0;
+    for (const uint32_t* node = friendsFirst; node != friendsLast; ++node)
+        counts[*node] = 0;
+    counts[self] = 0;
+    return page;
+}
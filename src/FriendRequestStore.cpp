@@ -0,0 +1,100 @@
+#include "FriendRequestStore.h"
+#include "IdGenerator.h"
+#include <algorithm>
+
+const char* requestStatusName(RequestStatus status) {
+    switch (status) {
+        case RequestStatus::Accepted: return "ACCEPTED";
+        case RequestStatus::Declined: return "DECLINED";
+        default: return "PENDING";
+    }
+}
+
+bool parseRequestStatus(std::string_view text, RequestStatus& status) {
+    if (text == "PENDING")
+        status = RequestStatus::Pending;
+    else if (text == "ACCEPTED")
+        status = RequestStatus::Accepted;
+    else if (text == "DECLINED")
+        status = RequestStatus::Declined;
+    else
+        return false;
+    return true;
+}
+
+FriendRequestStore::FriendRequestStore(IdGenerator& _ids) : ids(_ids) {
+}
+
+// Returns false, and stores nothing, if the same pending request already exists.
+bool FriendRequestStore::add(User* from, User* to, long long timestamp, RequestStatus status) {
+    size_t index = requests.size();
+    if (status == RequestStatus::Pending) {
+        if (!pendingByPair.emplace(std::make_pair(from, to), index).second)
+            return false;
+        inbox[to].push_back(index);
+        outbox[from].push_back(index);
+    }
+    requests.push_back({ids.next(), from, to, timestamp, status});
+    return true;
+}
+
+bool FriendRequestStore::resolve(const User* from, const User* to, RequestStatus newStatus) {
+    if (newStatus == RequestStatus::Pending)
+        return false;
+    auto it = pendingByPair.find({from, to});
+    if (it == pendingByPair.end())
+        return false;
+    size_t index = it->second;
+    pendingByPair.erase(it);
+    unlink(inbox[to], index);
+    unlink(outbox[from], index);
+    requests[index].status = newStatus;
+    return true;
+}
+
+bool FriendRequestStore::hasPending(const User* from, const User* to) const {
+    return pendingByPair.count({from, to}) != 0;
+}
+
+std::vector<User*> FriendRequestStore::pendingSendersTo(const User* to) const {
+    std::vector<User*> senders;
+    auto it = inbox.find(to);
+    if (it == inbox.end())
+        return senders;
+    senders.reserve(it->second.size());
+    for (size_t index : it->second)
+        senders.push_back(requests[index].from);
+    return senders;
+}
+
+std::vector<User*> FriendRequestStore::pendingRecipientsFrom(const User* from) const {
+    std::vector<User*> recipients;
+    auto it = outbox.find(from);
+    if (it == outbox.end())
+        return recipients;
+    recipients.reserve(it->second.size());
+    for (size_t index : it->second)
+        recipients.push_back(requests[index].to);
+    return recipients;
+}
+
+// IDs only grow, so the request list is sorted by ID.
+const FriendRequest* FriendRequestStore::find(uint64_t id) const {
+    auto it = std::lower_bound(requests.begin(), requests.end(), id,
+                               [](const FriendRequest& request, uint64_t value) { return request.id < value; });
+    return it != requests.end() && it->id == id ? &*it : nullptr;
+}
+
+void FriendRequestStore::clear() {
+    requests.clear();
+    pendingByPair.clear();
+    inbox.clear();
+    outbox.clear();
+}
+
+// Keeps the list in arrival order so inboxes list oldest requests first.
+void FriendRequestStore::unlink(std::vector<size_t>& list, size_t index) {
+    auto it = std::find(list.begin(), list.end(), index);
+    if (it != list.end())
+        list.erase(it);
+}
@@ -0,0 +1,277 @@
+#include "GraphAnalytics.h"
+#include "FriendGraph.h"
+#include "ThreadPool.h"
+#include "User.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <numeric>
+#include <string_view>
+
+const size_t ANALYTICS_SLICES_PER_THREAD = 16; // triangle work is skewed towards hubs, so slices are small
+
+GraphAnalytics::GraphAnalytics(const FriendGraph& _graph, ThreadPool* _pool) : graph(_graph), pool(_pool) {
+}
+
+// Calls work(begin, end) over [0, count) in slices, on the pool when there is one.
+template <typename Work>
+void GraphAnalytics::forEachSlice(size_t count, const Work& work) const {
+    if (pool == nullptr) {
+        work(size_t{0}, count);
+        return;
+    }
+    size_t sliceSize = count / (pool->size() * ANALYTICS_SLICES_PER_THREAD) + 1;
+    std::vector<std::future<void>> pending;
+    for (size_t begin = 0; begin < count; begin += sliceSize) {
+        size_t end = std::min(begin + sliceSize, count);
+        pending.push_back(pool->submit([&work, begin, end]() { work(begin, end); }));
+    }
+    for (std::future<void>& done : pending)
+        done.get();
+}
+
+GraphReport GraphAnalytics::run() const {
+    GraphReport report;
+    report.threads = pool == nullptr ? 1 : pool->size();
+    report.users = graph.nodeCount();
+    report.links = graph.edgeCount();
+    auto timed = [this, &report](void (GraphAnalytics::*pass)(GraphReport&) const) {
+        auto start = std::chrono::steady_clock::now();
+        (this->*pass)(report);
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    report.degreeSeconds = timed(&GraphAnalytics::countDegrees);
+    report.componentSeconds = timed(&GraphAnalytics::findComponents);
+    report.triangleSeconds = timed(&GraphAnalytics::countTriangles);
+    return report;
+}
+
+// Degrees, their percentiles and power-of-two histogram, and the users without friends or posts.
+void GraphAnalytics::countDegrees(GraphReport& report) const {
+    size_t nodeCount = graph.nodeCount();
+    std::vector<uint32_t> degrees(nodeCount);
+    std::vector<uint8_t> hasPosts(nodeCount);
+    forEachSlice(nodeCount, [&](size_t begin, size_t end) {
+        for (size_t node = begin; node < end; ++node) {
+            degrees[node] = static_cast<uint32_t>(graph.degree(static_cast<uint32_t>(node)));
+            hasPosts[node] = !graph.nodeAt(static_cast<uint32_t>(node))->getPosts().empty();
+        }
+    });
+    if (nodeCount == 0)
+        return;
+
+    uint64_t linkSum = 0;
+    report.minDegree = UINT32_MAX;
+    for (size_t node = 0; node < nodeCount; ++node) {
+        uint32_t degree = degrees[node];
+        linkSum += degree;
+        report.minDegree = std::min(report.minDegree, degree);
+        report.maxDegree = std::max(report.maxDegree, degree);
+        size_t bucket = std::bit_width(degree);
+        if (report.degreeBuckets.size() <= bucket)
+            report.degreeBuckets.resize(bucket + 1, 0);
+        ++report.degreeBuckets[bucket];
+        if (degree == 0 && report.usersWithoutFriends++ < GraphReport::EXAMPLE_IDS)
+            report.withoutFriendsExamples.emplace_back(graph.nodeAt(static_cast<uint32_t>(node))->getUserId());
+        if (!hasPosts[node] && report.usersWithoutPosts++ < GraphReport::EXAMPLE_IDS)
+            report.withoutPostsExamples.emplace_back(graph.nodeAt(static_cast<uint32_t>(node))->getUserId());
+    }
+    report.meanDegree = static_cast<double>(linkSum) / static_cast<double>(nodeCount);
+    auto percentile = [&degrees](double fraction) {
+        auto nth = degrees.begin() + static_cast<std::ptrdiff_t>(fraction * static_cast<double>(degrees.size() - 1));
+        std::nth_element(degrees.begin(), nth, degrees.end());
+        return *nth;
+    };
+    report.degreeP50 = percentile(0.5);
+    report.degreeP90 = percentile(0.9);
+    report.degreeP99 = percentile(0.99);
+}
+
+// Root of 'node', halving the path on the way: every node visited is pointed at its grandparent.
+// A lost race only means a shorter path stays unwritten.
+uint32_t analyticsFindRoot(std::vector<std::atomic<uint32_t>>& parent, uint32_t node) {
+    while (true) {
+        uint32_t up = parent[node].load(std::memory_order_relaxed);
+        if (up == node)
+            return node;
+        uint32_t upper = parent[up].load(std::memory_order_relaxed);
+        if (up != upper)
+            parent[node].compare_exchange_weak(up, upper, std::memory_order_relaxed);
+        node = upper;
+    }
+}
+
+void analyticsUnite(std::vector<std::atomic<uint32_t>>& parent, uint32_t a, uint32_t b) {
+    while (true) {
+        a = analyticsFindRoot(parent, a);
+        b = analyticsFindRoot(parent, b);
+        if (a == b)
+            return;
+        if (a > b)
+            std::swap(a, b);
+        // b may have been linked under another root meanwhile; then find again
+        uint32_t expected = b;
+        if (parent[b].compare_exchange_strong(expected, a, std::memory_order_relaxed))
+            return;
+    }
+}
+
+void GraphAnalytics::findComponents(GraphReport& report) const {
+    size_t nodeCount = graph.nodeCount();
+    std::vector<std::atomic<uint32_t>> parent(nodeCount);
+    forEachSlice(nodeCount, [&](size_t begin, size_t end) {
+        for (size_t node = begin; node < end; ++node)
+            parent[node].store(static_cast<uint32_t>(node), std::memory_order_relaxed);
+    });
+    forEachSlice(nodeCount, [&](size_t begin, size_t end) {
+        std::vector<uint32_t> scratch;
+        for (size_t node = begin; node < end; ++node) {
+            auto [first, last] = graph.sortedRow(static_cast<uint32_t>(node), scratch);
+            // rows are sorted, so the friends above 'node' are a suffix; each friendship is united once
+            for (first = std::upper_bound(first, last, static_cast<uint32_t>(node)); first != last; ++first)
+                analyticsUnite(parent, static_cast<uint32_t>(node), *first);
+        }
+    });
+    // the pool's futures have synchronized every union with this thread
+    std::vector<uint32_t> sizes(nodeCount, 0);
+    for (size_t node = 0; node < nodeCount; ++node)
+        ++sizes[analyticsFindRoot(parent, static_cast<uint32_t>(node))];
+    std::vector<uint64_t> componentSizes;
+    for (uint32_t size : sizes) {
+        if (size > 0)
+            componentSizes.push_back(size);
+    }
+    report.components = componentSizes.size();
+    size_t kept = std::min(componentSizes.size(), GraphReport::LARGEST_COMPONENTS);
+    std::partial_sort(componentSizes.begin(), componentSizes.begin() + static_cast<std::ptrdiff_t>(kept),
+                      componentSizes.end(), std::greater<uint64_t>());
+    report.largestComponents.assign(componentSizes.begin(), componentSizes.begin() + static_cast<std::ptrdiff_t>(kept));
+}
+
+void GraphAnalytics::countTriangles(GraphReport& report) const {
+    size_t nodeCount = graph.nodeCount();
+    auto below = [this](uint32_t a, uint32_t b) {
+        size_t degreeA = graph.degree(a), degreeB = graph.degree(b);
+        return degreeA != degreeB ? degreeA < degreeB : a < b;
+    };
+    // oriented rows in CSR form, each still sorted by node index
+    std::vector<uint64_t> offsets(nodeCount + 1, 0);
+    forEachSlice(nodeCount, [&](size_t begin, size_t end) {
+        std::vector<uint32_t> scratch;
+        for (size_t node = begin; node < end; ++node) {
+            auto [first, last] = graph.sortedRow(static_cast<uint32_t>(node), scratch);
+            offsets[node + 1] = static_cast<uint64_t>(
+                std::count_if(first, last, [&](uint32_t other) { return below(static_cast<uint32_t>(node), other); }));
+        }
+    });
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<uint32_t> targets(offsets[nodeCount]);
+    forEachSlice(nodeCount, [&](size_t begin, size_t end) {
+        std::vector<uint32_t> scratch;
+        for (size_t node = begin; node < end; ++node) {
+            auto [first, last] = graph.sortedRow(static_cast<uint32_t>(node), scratch);
+            std::copy_if(first, last, targets.begin() + static_cast<std::ptrdiff_t>(offsets[node]),
+                         [&](uint32_t other) { return below(static_cast<uint32_t>(node), other); });
+        }
+    });
+
+    std::vector<std::atomic<uint32_t>> perUser(nodeCount);
+    std::atomic<uint64_t> total{0};
+    forEachSlice(nodeCount, [&](size_t begin, size_t end) {
+        uint64_t found = 0;
+        for (size_t a = begin; a < end; ++a) {
+            const uint32_t* aFirst = targets.data() + offsets[a];
+            const uint32_t* aLast = targets.data() + offsets[a + 1];
+            for (const uint32_t* b = aFirst; b != aLast; ++b) {
+                const uint32_t* x = aFirst;
+                const uint32_t* y = targets.data() + offsets[*b];
+                const uint32_t* yLast = targets.data() + offsets[*b + 1];
+                while (x != aLast && y != yLast) {
+                    if (*x < *y) {
+                        ++x;
+                    } else if (*y < *x) {
+                        ++y;
+                    } else {
+                        ++found;
+                        perUser[a].fetch_add(1, std::memory_order_relaxed);
+                        perUser[*b].fetch_add(1, std::memory_order_relaxed);
+                        perUser[*x].fetch_add(1, std::memory_order_relaxed);
+                        ++x;
+                        ++y;
+                    }
+                }
+            }
+        }
+        total.fetch_add(found, std::memory_order_relaxed);
+    });
+    report.triangles = total.load();
+
+    double triples = 0, clusteringSum = 0;
+    uint64_t clustered = 0;
+    for (size_t node = 0; node < nodeCount; ++node) {
+        double degree = static_cast<double>(graph.degree(static_cast<uint32_t>(node)));
+        if (degree < 2)
+            continue;
+        double pairs = degree * (degree - 1) / 2;
+        triples += pairs;
+        clusteringSum += perUser[node].load(std::memory_order_relaxed) / pairs;
+        ++clustered;
+    }
+    report.transitivity = triples > 0 ? 3 * static_cast<double>(report.triangles) / triples : 0;
+    report.averageClustering = clustered > 0 ? clusteringSum / static_cast<double>(clustered) : 0;
+}
+
+void writeJsonString(std::ostream& out, std::string_view text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+void GraphReport::writeJson(std::ostream& out) const {
+    auto list = [&out](const auto& values, auto write) {
+        out << '[';
+        for (size_t i = 0; i < values.size(); ++i) {
+            out << (i ? ", " : "");
+            write(values[i]);
+        }
+        out << ']';
+    };
+    auto number = [&out](uint64_t value) { out << value; };
+    auto text = [&out](const std::string& value) { writeJsonString(out, value); };
+
+    out << "{\n  \"users\": " << users << ",\n  \"links\": " << links << ",\n  \"friendships\": " << links / 2
+        << ",\n  \"threads\": " << threads << ",\n";
+    out << std::fixed << std::setprecision(6);
+    out << "  \"degree\": {\"min\": " << minDegree << ", \"max\": " << maxDegree << ", \"mean\": " << meanDegree
+        << ", \"p50\": " << degreeP50 << ", \"p90\": " << degreeP90 << ", \"p99\": " << degreeP99 << ",\n"
+        << "    \"histogram\": [";
+    for (size_t i = 0; i < degreeBuckets.size(); ++i) {
+        uint64_t from = i == 0 ? 0 : uint64_t{1} << (i - 1);
+        uint64_t to = i == 0 ? 0 : (uint64_t{1} << i) - 1;
+        out << (i ? ",\n      " : "\n      ") << "{\"from\": " << from << ", \"to\": " << to << ", \"users\": "
+            << degreeBuckets[i] << "}";
+    }
+    out << "\n    ]},\n";
+    out << "  \"components\": {\"count\": " << components << ", \"largest\": ";
+    list(largestComponents, number);
+    out << "},\n";
+    out << "  \"clustering\": {\"triangles\": " << triangles << ", \"transitivity\": " << transitivity
+        << ", \"average_local\": " << averageClustering << "},\n";
+    out << "  \"users_without_friends\": {\"count\": " << usersWithoutFriends << ", \"examples\": ";
+    list(withoutFriendsExamples, text);
+    out << "},\n  \"users_without_posts\": {\"count\": " << usersWithoutPosts << ", \"examples\": ";
+    list(withoutPostsExamples, text);
+    out << "},\n";
+    out << "  \"seconds\": {\"degrees\": " << degreeSeconds << ", \"components\": " << componentSeconds
+        << ", \"triangles\": " << triangleSeconds << "}\n}\n";
+}
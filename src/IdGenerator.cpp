@@ -0,0 +1,28 @@
+#include "IdGenerator.h"
+
+IdGenerator::IdGenerator(uint32_t workerId)
+    : workerBits(uint64_t{workerId & MAX_WORKER} << SEQUENCE_BITS), last(workerBits) {
+}
+
+uint64_t IdGenerator::next() {
+    long long nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    uint64_t now = nowMs > ID_EPOCH_MS ? static_cast<uint64_t>(nowMs - ID_EPOCH_MS) : 0;
+
+    uint64_t previous = last.load(std::memory_order_relaxed);
+    uint64_t id;
+    do {
+        uint64_t previousTime = previous >> TIMESTAMP_SHIFT;
+        if (now > previousTime)
+            id = (now << TIMESTAMP_SHIFT) | workerBits;
+        else if ((previous & SEQUENCE_MASK) < SEQUENCE_MASK)
+            id = previous + 1;
+        else
+            id = ((previousTime + 1) << TIMESTAMP_SHIFT) | workerBits; // sequence exhausted, borrow a millisecond
+    } while (!last.compare_exchange_weak(previous, id, std::memory_order_relaxed));
+    return id;
+}
+
+std::chrono::system_clock::time_point IdGenerator::timeOf(uint64_t id) {
+    return std::chrono::system_clock::time_point(std::chrono::milliseconds(ID_EPOCH_MS + static_cast<long long>(id >> TIMESTAMP_SHIFT)));
+}
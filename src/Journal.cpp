@@ -0,0 +1,94 @@
+#include "Journal.h"
+#include "Metrics.h"
+#include "MappedFile.h"
+#include "TextParsing.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+const std::string_view GENERATION_PREFIX = "GENERATION#";
+
+Journal::Journal(std::string _path, bool readOnly) : path(std::move(_path)) {
+    if (!readOnly) {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd == -1) {
+            std::cerr << "Error opening journal " << path << " for appending." << std::endl;
+            return;
+        }
+    }
+    MappedFile file(path);
+    std::string_view remaining = file.view();
+    std::string_view line;
+    if (remaining.empty()) {
+        if (!readOnly)
+            startGeneration();
+    }
+    else if (nextLine(remaining, line) && line.substr(0, GENERATION_PREFIX.size()) == GENERATION_PREFIX)
+        parseNumber(line.substr(GENERATION_PREFIX.size()), generation);
+}
+
+Journal::~Journal() {
+    if (fd != -1)
+        ::close(fd);
+}
+
+// One write() per line so concurrent appends never interleave within a line.
+bool Journal::writeLine(std::string_view text) {
+    std::string line;
+    line.reserve(text.size() + 1);
+    line.append(text).push_back('\n');
+    size_t written = 0;
+    while (written < line.size()) {
+        ssize_t result = ::write(fd, line.data() + written, line.size() - written);
+        if (result < 0) {
+            std::cerr << "Error appending to journal " << path << "." << std::endl;
+            return false;
+        }
+        written += static_cast<size_t>(result);
+    }
+    return true;
+}
+
+// Generations are the clock in nanoseconds, and always above the last one.
+bool Journal::startGeneration() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    generation = std::max<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count(), generation + 1);
+    return writeLine(std::string(GENERATION_PREFIX) + std::to_string(generation));
+}
+
+bool Journal::append(std::string_view record) {
+    if (fd == -1 || !writeLine(record))
+        return false;
+    recordCount++;
+    Metrics::count(Counter::JournalRecords);
+    return true;
+}
+
+size_t Journal::replay(const std::function<void(std::string_view record)>& apply) {
+    MappedFile file(path);
+    std::string_view remaining = file.view();
+    std::string_view line;
+    size_t replayed = 0;
+    while (nextLine(remaining, line)) {
+        if (remaining.empty() && file.view().back() != '\n')
+            break; // torn write from a crash, the mutation never completed
+        if (line.empty() || (replayed == 0 && line.substr(0, GENERATION_PREFIX.size()) == GENERATION_PREFIX))
+            continue;
+        apply(line);
+        replayed++;
+    }
+    recordCount = replayed;
+    return replayed;
+}
+
+bool Journal::truncate() {
+    if (fd == -1 || ::ftruncate(fd, 0) != 0) {
+        std::cerr << "Error truncating journal " << path << "." << std::endl;
+        return false;
+    }
+    recordCount = 0;
+    return startGeneration();
+}
@@ -0,0 +1,58 @@
+#include "MappedFile.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+MappedFile::MappedFile(const std::string& path) {
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return;
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+        release();
+        return;
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length == 0) // mmap rejects empty mappings, an empty view is enough
+        return;
+    void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        length = 0;
+        release();
+        return;
+    }
+    ::madvise(mapping, length, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(mapping);
+}
+
+MappedFile::~MappedFile() {
+    release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data(std::exchange(other.data, nullptr)),
+      length(std::exchange(other.length, 0)),
+      fd(std::exchange(other.fd, -1)) {
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        release();
+        data = std::exchange(other.data, nullptr);
+        length = std::exchange(other.length, 0);
+        fd = std::exchange(other.fd, -1);
+    }
+    return *this;
+}
+
+void MappedFile::release() {
+    if (data != nullptr)
+        ::munmap(const_cast<char*>(data), length);
+    if (fd != -1)
+        ::close(fd);
+    data = nullptr;
+    length = 0;
+    fd = -1;
+}
@@ -0,0 +1,187 @@
+#include "Metrics.h"
+#include <bit>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+std::atomic<bool> Metrics::enabledFlag{false};
+
+const char* const TIMER_NAMES[] = {"parse_users", "parse_friends", "parse_posts", "parse_requests", "load_snapshot",
+                                   "replay_journal", "feed_query", "feed_build", "create_post", "login", "password_hash",
+                                   "save_users", "save_friends", "save_requests", "save_snapshot", "compaction",
+                                   "index_posts", "search_posts", "index_usernames", "suggest_usernames",
+                                   "recommend_friends", "save_recommendations", "find_connection"};
+const char* const COUNTER_NAMES[] = {"login_succeeded", "login_failed", "login_busy", "posts_created", "feed_posts_served",
+                                     "journal_records"};
+
+// One thread's share of every metric. Only its own thread writes it, so increments are a relaxed
+// load and store rather than a locked read-modify-write; snapshot() may read it at any time.
+struct ThreadMetrics {
+    std::array<std::array<std::atomic<uint64_t>, Metrics::BUCKET_COUNT>, TIMER_COUNT> buckets{};
+    std::array<std::atomic<uint64_t>, TIMER_COUNT> sums{};
+    std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters{};
+};
+
+std::mutex metricsRegistryMutex;
+std::vector<std::unique_ptr<ThreadMetrics>> metricsRegistry; // never shrinks, a thread's counts outlive it
+
+ThreadMetrics& localMetrics() {
+    thread_local ThreadMetrics* mine = nullptr;
+    if (mine == nullptr) {
+        auto block = std::make_unique<ThreadMetrics>();
+        mine = block.get();
+        std::lock_guard<std::mutex> lock(metricsRegistryMutex);
+        metricsRegistry.push_back(std::move(block));
+    }
+    return *mine;
+}
+
+void bumpMetric(std::atomic<uint64_t>& cell, uint64_t amount) {
+    cell.store(cell.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+size_t Metrics::bucketOf(uint64_t nanos) {
+    if (nanos < SUB_BUCKETS)
+        return static_cast<size_t>(nanos);
+    unsigned exponent = static_cast<unsigned>(std::bit_width(nanos)) - 1;
+    if (exponent > MAX_EXPONENT)
+        return BUCKET_COUNT - 1;
+    uint64_t subBucket = (nanos >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return static_cast<size_t>((exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + subBucket);
+}
+
+uint64_t Metrics::Histogram::lowerBound(size_t index) {
+    if (index < SUB_BUCKETS)
+        return index;
+    unsigned exponent = static_cast<unsigned>(index / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+    return (SUB_BUCKETS + index % SUB_BUCKETS) << (exponent - SUB_BUCKET_BITS);
+}
+
+uint64_t Metrics::Histogram::quantile(double fraction) const {
+    if (count == 0)
+        return 0;
+    uint64_t rank = static_cast<uint64_t>(fraction * static_cast<double>(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets[i];
+        if (seen >= rank)
+            return i + 1 < BUCKET_COUNT ? lowerBound(i + 1) - 1 : lowerBound(i);
+    }
+    return lowerBound(BUCKET_COUNT - 1);
+}
+
+void Metrics::record(Timer timer, uint64_t nanos) {
+    ThreadMetrics& mine = localMetrics();
+    size_t index = static_cast<size_t>(timer);
+    bumpMetric(mine.buckets[index][bucketOf(nanos)], 1);
+    bumpMetric(mine.sums[index], nanos);
+}
+
+void Metrics::addToCounter(Counter counter, uint64_t amount) {
+    bumpMetric(localMetrics().counters[static_cast<size_t>(counter)], amount);
+}
+
+Metrics::Snapshot Metrics::snapshot() {
+    Snapshot total;
+    std::lock_guard<std::mutex> lock(metricsRegistryMutex);
+    for (const std::unique_ptr<ThreadMetrics>& block : metricsRegistry) {
+        for (size_t t = 0; t < TIMER_COUNT; ++t) {
+            Histogram& histogram = total.timers[t];
+            for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                uint64_t hits = block->buckets[t][i].load(std::memory_order_relaxed);
+                histogram.buckets[i] += hits;
+                histogram.count += hits;
+            }
+            histogram.sumNanos += block->sums[t].load(std::memory_order_relaxed);
+        }
+        for (size_t c = 0; c < COUNTER_COUNT; ++c)
+            total.counters[c] += block->counters[c].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+const char* Metrics::name(Timer timer) {
+    return TIMER_NAMES[static_cast<size_t>(timer)];
+}
+
+const char* Metrics::name(Counter counter) {
+    return COUNTER_NAMES[static_cast<size_t>(counter)];
+}
+
+bool Metrics::writePrometheus(const std::string& path) {
+    Snapshot metrics = snapshot();
+    std::string tempPath = path + ".tmp";
+    std::ofstream out(tempPath, std::ios::out | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Error opening " << tempPath << " for writing metrics." << std::endl;
+        return false;
+    }
+    // cumulative buckets at each power of two, which is coarser than the histogram but keeps the
+    // dump to a few dozen lines per operation
+    out << "# HELP fakebook_op_duration_seconds Time spent in instrumented FakeBook operations.\n"
+        << "# TYPE fakebook_op_duration_seconds histogram\n";
+    for (size_t t = 0; t < TIMER_COUNT; ++t) {
+        const Histogram& histogram = metrics.timers[t];
+        const char* op = TIMER_NAMES[t];
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < BUCKET_COUNT && cumulative < histogram.count; ++i) {
+            cumulative += histogram.buckets[i];
+            bool lastOfPower = i + 1 >= SUB_BUCKETS && (i + 1) % SUB_BUCKETS == 0;
+            if (lastOfPower && i + 1 < BUCKET_COUNT)
+                out << "fakebook_op_duration_seconds_bucket{op=\"" << op << "\",le=\""
+                    << static_cast<double>(Histogram::lowerBound(i + 1)) * 1e-9 << "\"} " << cumulative << '\n';
+        }
+        out << "fakebook_op_duration_seconds_bucket{op=\"" << op << "\",le=\"+Inf\"} " << histogram.count << '\n'
+            << "fakebook_op_duration_seconds_sum{op=\"" << op << "\"} " << static_cast<double>(histogram.sumNanos) * 1e-9 << '\n'
+            << "fakebook_op_duration_seconds_count{op=\"" << op << "\"} " << histogram.count << '\n';
+    }
+    out << "# HELP fakebook_op_duration_quantile_seconds Latency quantiles from the same histograms, within 1/16.\n"
+        << "# TYPE fakebook_op_duration_quantile_seconds gauge\n";
+    for (size_t t = 0; t < TIMER_COUNT; ++t) {
+        for (double quantile : {0.5, 0.9, 0.99, 0.999}) {
+            out << "fakebook_op_duration_quantile_seconds{op=\"" << TIMER_NAMES[t] << "\",quantile=\"" << quantile << "\"} "
+                << static_cast<double>(metrics.timers[t].quantile(quantile)) * 1e-9 << '\n';
+        }
+    }
+    out << "# HELP fakebook_events_total Instrumented FakeBook events.\n"
+        << "# TYPE fakebook_events_total counter\n";
+    for (size_t c = 0; c < COUNTER_COUNT; ++c)
+        out << "fakebook_events_total{event=\"" << COUNTER_NAMES[c] << "\"} " << metrics.counters[c] << '\n';
+    out.close();
+    if (!out) {
+        std::cerr << "Error writing " << tempPath << "." << std::endl;
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::cerr << "Error replacing " << path << ": " << error.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+MetricsExporter::MetricsExporter(std::string _path, unsigned _intervalSeconds)
+    : path(std::move(_path)), intervalSeconds(_intervalSeconds > 0 ? _intervalSeconds : 1),
+      worker(&MetricsExporter::exportLoop, this) {}
+
+MetricsExporter::~MetricsExporter() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+    Metrics::writePrometheus(path);
+}
+
+void MetricsExporter::exportLoop() {
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    while (!wake.wait_for(lock, std::chrono::seconds(intervalSeconds), [this]() { return stopping; })) {
+        lock.unlock();
+        Metrics::writePrometheus(path);
+        lock.lock();
+    }
+}
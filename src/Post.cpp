@@ -6,26 +6,23 @@
 #include <iomanip>
 #include <sstream>
 
-Post::Post(User* author, std::string _content, std::chrono::system_clock::time_point timeStamp, bool _isPublic, std::string _postId)
-    : postId(_postId),
-      authorId(author),
-      content(_content),
-      isPublicPost(_isPublic),
-      timeUploaded(timeStamp)
-{
-}
-
-void Post::displayPost() {
-    std::time_t postTime_t = std::chrono::system_clock::to_time_t(this->timeUploaded);
+void Post::displayPost() const {
+    std::time_t postTime_t = std::chrono::system_clock::to_time_t(getTimestamp());
     std::tm timeInfo = *std::localtime(&postTime_t);
     std::stringstream timeStream;
     timeStream << std::put_time(&timeInfo, "%Y-%m-%d %H:%M");
     std::string formattedTime = timeStream.str();
 
     std::cout << "--------------------" << std::endl;
-    std::cout << "Post by: " << this->authorId->getUserName() << std::endl;
-    std::cout << this->content << std::endl;
+    std::cout << "Post by: " << getAuthor()->getUserName() << std::endl;
+    std::cout << getContent() << std::endl;
     std::cout << "Posted on: " << formattedTime << std::endl;
-    std::cout << "Visibility: " << (this->isPublicPost ? "Public" : "Friends Only") << std::endl;
+    std::cout << "Visibility: " << (isPublic() ? "Public" : "Friends Only") << std::endl;
     std::cout << "--------------------" << std::endl;
-}
\ No newline at end of file
+}
+
+void Post::writeLine(std::ostream& out) const {
+    out << getPostId() << '#' << getAuthor()->getUserId() << '#' << getContent() << '#'
+        << std::chrono::duration_cast<std::chrono::seconds>(getTimestamp().time_since_epoch()).count() << '#'
+        << (isPublic() ? "Public" : "FriendsOnly");
+}
@@ -0,0 +1,319 @@
+#include "PostIndex.h"
+#include "PostStore.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <future>
+#include <utility>
+
+const size_t POSTS_PER_INDEX_CHUNK = 1 << 16;
+
+void appendVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t readVarint(const uint8_t*& in) {
+    uint32_t value = 0;
+    for (unsigned shift = 0;; shift += 7) {
+        uint8_t byte = *in++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte < 0x80)
+            return value;
+    }
+}
+
+void PostIndex::PostingList::add(uint32_t row, const std::vector<uint32_t>& positions) {
+    if (blocks.empty() || blocks.back().count == BLOCK_POSTINGS)
+        blocks.push_back({row, row, 0, bytes.size()});
+    Block& block = blocks.back();
+    appendVarint(bytes, row - block.lastRow);
+    appendVarint(bytes, static_cast<uint32_t>(positions.size()));
+    uint32_t previous = 0;
+    for (uint32_t position : positions) {
+        appendVarint(bytes, position - previous);
+        previous = position;
+    }
+    block.lastRow = row;
+    block.count++;
+    postings++;
+}
+
+void PostIndex::PostingList::append(const PostingList& later) {
+    uint64_t base = bytes.size();
+    bytes.insert(bytes.end(), later.bytes.begin(), later.bytes.end());
+    for (Block block : later.blocks) {
+        block.offset += base;
+        blocks.push_back(block);
+    }
+    postings += later.postings;
+}
+
+size_t PostIndex::shardOf(std::string_view word) {
+    return std::hash<std::string_view>()(word) % TERM_SHARDS;
+}
+
+// Reusable buffers for indexing one post at a time.
+struct PostWords {
+    std::vector<std::pair<uint64_t, uint32_t>> words; // shard << 32 | term key, position
+    std::vector<uint32_t> positions;
+};
+
+// Adds one post to 'termShards', grouping each word's positions into one posting.
+void indexPostWords(PostIndex::TermShards& termShards, PostWords& scratch, uint32_t row, std::string_view content) {
+    scratch.words.clear();
+    PostIndex::forEachWord(content, [&](std::string_view word, uint32_t position) {
+        size_t shard = PostIndex::shardOf(word);
+        uint64_t term = termShards[shard].terms.intern(word);
+        scratch.words.emplace_back(static_cast<uint64_t>(shard) << 32 | term, position);
+    });
+    std::sort(scratch.words.begin(), scratch.words.end());
+    for (size_t i = 0; i < scratch.words.size();) {
+        uint64_t shardTerm = scratch.words[i].first;
+        scratch.positions.clear();
+        for (; i < scratch.words.size() && scratch.words[i].first == shardTerm; ++i)
+            scratch.positions.push_back(scratch.words[i].second);
+        PostIndex::TermShard& shard = termShards[shardTerm >> 32];
+        if (shard.postings.size() < shard.terms.size())
+            shard.postings.resize(shard.terms.size());
+        shard.postings[static_cast<uint32_t>(shardTerm)].add(row, scratch.positions);
+    }
+}
+
+// Chunks of rows are indexed into private dictionaries in parallel. Each term shard then takes
+// its part of every chunk in row order: a chunk's rows all come after the previous chunk's, so
+// its blocks can be appended as they are.
+void PostIndex::build(const PostStore& store, ThreadPool* pool) {
+    clear();
+    size_t chunkCount = (store.size() + POSTS_PER_INDEX_CHUNK - 1) / POSTS_PER_INDEX_CHUNK;
+    std::vector<TermShards> chunks(chunkCount);
+    auto indexChunk = [&store, &chunks](size_t chunkIndex) {
+        PostWords scratch;
+        uint32_t begin = static_cast<uint32_t>(chunkIndex * POSTS_PER_INDEX_CHUNK);
+        uint32_t end = static_cast<uint32_t>(std::min(store.size(), (chunkIndex + 1) * POSTS_PER_INDEX_CHUNK));
+        for (uint32_t row = begin; row < end; ++row)
+            indexPostWords(chunks[chunkIndex], scratch, row, store.content(row));
+    };
+    auto mergeShard = [this, &chunks](size_t shardIndex) {
+        TermShard& shard = shards[shardIndex];
+        size_t termsInChunks = 0;
+        for (const TermShards& chunk : chunks)
+            termsInChunks += chunk[shardIndex].terms.size();
+        shard.terms.reserve(termsInChunks);
+        shard.postings.reserve(termsInChunks);
+        for (TermShards& chunk : chunks) {
+            TermShard& part = chunk[shardIndex];
+            for (uint32_t local = 0; local < part.terms.size(); ++local) {
+                uint32_t term = shard.terms.intern(part.terms.view(local));
+                if (shard.postings.size() < shard.terms.size())
+                    shard.postings.resize(shard.terms.size());
+                if (shard.postings[term].postings == 0)
+                    shard.postings[term] = std::move(part.postings[local]);
+                else
+                    shard.postings[term].append(part.postings[local]);
+            }
+            part = TermShard();
+        }
+    };
+    if (pool == nullptr) {
+        for (size_t i = 0; i < chunkCount; ++i)
+            indexChunk(i);
+        for (size_t i = 0; i < TERM_SHARDS; ++i)
+            mergeShard(i);
+        return;
+    }
+    std::vector<std::future<void>> pending;
+    for (size_t i = 0; i < chunkCount; ++i)
+        pending.push_back(pool->submit([&indexChunk, i]() { indexChunk(i); }));
+    for (std::future<void>& done : pending)
+        done.get();
+    pending.clear();
+    for (size_t i = 0; i < TERM_SHARDS; ++i)
+        pending.push_back(pool->submit([&mergeShard, i]() { mergeShard(i); }));
+    for (std::future<void>& done : pending)
+        done.get();
+}
+
+void PostIndex::add(uint32_t row, std::string_view content) {
+    PostWords scratch;
+    indexPostWords(shards, scratch, row, content);
+}
+
+void PostIndex::clear() {
+    for (TermShard& shard : shards)
+        shard = TermShard();
+}
+
+size_t PostIndex::termCount() const {
+    size_t total = 0;
+    for (const TermShard& shard : shards)
+        total += shard.terms.size();
+    return total;
+}
+
+size_t PostIndex::compressedBytes() const {
+    size_t total = 0;
+    for (const TermShard& shard : shards) {
+        for (const PostingList& list : shard.postings)
+            total += list.bytes.size() + list.blocks.size() * sizeof(Block);
+    }
+    return total;
+}
+
+const PostIndex::PostingList* PostIndex::find(std::string_view word) const {
+    const TermShard& shard = shards[shardOf(word)];
+    uint32_t term = shard.terms.find(word);
+    return term == StringPool::NOT_FOUND ? nullptr : &shard.postings[term];
+}
+
+// Walks one posting list from high rows to low, decoding a block at a time.
+class PostingCursor {
+private:
+    const PostIndex::PostingList* list;
+    size_t block = SIZE_MAX; // the decoded block
+    std::vector<uint32_t> rows;
+    std::vector<uint32_t> positionStarts; // rows.size() + 1 offsets into 'positions'
+    std::vector<uint32_t> positions;
+    size_t current = 0;
+
+    void decode(size_t blockIndex) {
+        block = blockIndex;
+        const PostIndex::Block& header = list->blocks[blockIndex];
+        const uint8_t* in = list->bytes.data() + header.offset;
+        rows.clear();
+        positionStarts.assign(1, 0);
+        positions.clear();
+        uint32_t row = header.firstRow;
+        for (uint32_t i = 0; i < header.count; ++i) {
+            row += readVarint(in);
+            rows.push_back(row);
+            uint32_t count = readVarint(in);
+            uint32_t position = 0;
+            for (uint32_t k = 0; k < count; ++k) {
+                position += readVarint(in);
+                positions.push_back(position);
+            }
+            positionStarts.push_back(static_cast<uint32_t>(positions.size()));
+        }
+    }
+public:
+    explicit PostingCursor(const PostIndex::PostingList& _list) : list(&_list) {}
+
+    // Moves to the highest posting at or below 'target'; false when there is none.
+    bool seekAtOrBelow(uint32_t target) {
+        const std::vector<PostIndex::Block>& blocks = list->blocks;
+        auto after = std::upper_bound(blocks.begin(), blocks.end(), target,
+                                      [](uint32_t row, const PostIndex::Block& b) { return row < b.firstRow; });
+        if (after == blocks.begin())
+            return false;
+        size_t blockIndex = static_cast<size_t>(after - blocks.begin()) - 1;
+        if (blockIndex != block)
+            decode(blockIndex);
+        current = static_cast<size_t>(std::upper_bound(rows.begin(), rows.end(), target) - rows.begin()) - 1;
+        return true;
+    }
+    uint32_t row() const { return rows[current]; }
+    bool hasPosition(uint32_t position) const {
+        return std::binary_search(positions.begin() + positionStarts[current], positions.begin() + positionStarts[current + 1],
+                                  position);
+    }
+    const uint32_t* positionsBegin() const { return positions.data() + positionStarts[current]; }
+    const uint32_t* positionsEnd() const { return positions.data() + positionStarts[current + 1]; }
+};
+
+SearchPage PostIndex::search(std::string_view query, size_t limit, uint32_t before,
+                             const std::function<bool(uint32_t row)>& visible) const {
+    SearchPage page;
+    // each part is a phrase of posting lists; a bare word is a phrase of one
+    std::vector<std::vector<const PostingList*>> parts;
+    bool unknownWord = false;
+    auto addPart = [&](std::string_view text) {
+        std::vector<const PostingList*> phrase;
+        forEachWord(text, [&](std::string_view word, uint32_t) {
+            const PostingList* list = find(word);
+            if (list == nullptr)
+                unknownWord = true;
+            phrase.push_back(list);
+        });
+        if (!phrase.empty())
+            parts.push_back(std::move(phrase));
+    };
+    for (size_t i = 0; i < query.size();) {
+        if (query[i] == ' ' || query[i] == '\t') {
+            ++i;
+        } else if (query[i] == '"') {
+            size_t close = query.find('"', i + 1);
+            size_t end = close == std::string_view::npos ? query.size() : close;
+            addPart(query.substr(i + 1, end - i - 1));
+            i = end + 1;
+        } else {
+            size_t end = query.find_first_of(" \t\"", i);
+            end = end == std::string_view::npos ? query.size() : end;
+            addPart(query.substr(i, end - i));
+            i = end;
+        }
+    }
+    if (parts.empty() || unknownWord || limit == 0 || before == 0)
+        return page;
+
+    // one cursor per distinct term, rarest first, so it proposes the fewest candidates
+    std::vector<const PostingList*> distinct;
+    for (const std::vector<const PostingList*>& phrase : parts)
+        distinct.insert(distinct.end(), phrase.begin(), phrase.end());
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+    std::sort(distinct.begin(), distinct.end(),
+              [](const PostingList* a, const PostingList* b) { return a->postings < b->postings; });
+    std::vector<PostingCursor> cursors;
+    for (const PostingList* list : distinct)
+        cursors.emplace_back(*list);
+    auto cursorOf = [&](const PostingList* list) -> const PostingCursor& {
+        return cursors[static_cast<size_t>(std::find(distinct.begin(), distinct.end(), list) - distinct.begin())];
+    };
+    auto phrasesMatch = [&]() {
+        for (const std::vector<const PostingList*>& phrase : parts) {
+            if (phrase.size() == 1)
+                continue;
+            const PostingCursor& first = cursorOf(phrase[0]);
+            bool found = false;
+            for (const uint32_t* start = first.positionsBegin(); start != first.positionsEnd() && !found; ++start) {
+                found = true;
+                for (size_t k = 1; k < phrase.size() && found; ++k)
+                    found = cursorOf(phrase[k]).hasPosition(*start + static_cast<uint32_t>(k));
+            }
+            if (!found)
+                return false;
+        }
+        return true;
+    };
+
+    // leapfrog from the top: every cursor seeks to the highest row all of them might share
+    uint32_t candidate = before - 1;
+    while (true) {
+        bool agreed = true;
+        for (PostingCursor& cursor : cursors) {
+            if (!cursor.seekAtOrBelow(candidate))
+                return page;
+            if (cursor.row() < candidate) {
+                candidate = cursor.row();
+                agreed = false;
+                break;
+            }
+        }
+        if (!agreed)
+            continue;
+        if (phrasesMatch() && visible(candidate)) {
+            if (page.posts.size() == limit) {
+                page.hasMore = true;
+                return page;
+            }
+            page.posts.push_back(candidate);
+            page.next = candidate;
+        }
+        if (candidate == 0)
+            return page;
+        --candidate;
+    }
+}
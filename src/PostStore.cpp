@@ -0,0 +1,71 @@
+#include "PostStore.h"
+#include "Post.h"
+#include "User.h"
+
+PostStore::PostStore(const FriendGraph& _graph) : graph(&_graph) {
+}
+
+uint32_t PostStore::append(const User* author, std::string_view postId, std::string_view content,
+                           std::chrono::system_clock::time_point timeStamp, bool isPublic) {
+    uint32_t row = static_cast<uint32_t>(times.size());
+    times.push_back(timeStamp.time_since_epoch().count());
+    authors.push_back(author->getGraphIndex());
+    postKeys.push_back(ids.intern(postId));
+    if (row % 64 == 0)
+        publicBits.push_back(0);
+    publicBits.back() |= uint64_t{isPublic} << (row % 64);
+    if (contentOffsets.back() < borrowedText.size()) {
+        contentOffsets.push_back(contentOffsets.back() + content.size());
+    } else {
+        contentText.append(content);
+        contentOffsets.push_back(borrowedText.size() + contentText.size());
+    }
+    return row;
+}
+
+void PostStore::borrow(std::string_view text, std::string_view idText) {
+    borrowedText = text;
+    ids.borrow(idText);
+}
+
+void PostStore::reserve(size_t posts, size_t contentBytes) {
+    posts += size();
+    times.reserve(posts);
+    authors.reserve(posts);
+    postKeys.reserve(posts);
+    ids.reserve(posts);
+    publicBits.reserve((posts + 63) / 64);
+    contentOffsets.reserve(posts + 1);
+    contentText.reserve(contentText.size() + contentBytes);
+}
+
+void PostStore::clear() {
+    ids.clear();
+    times.clear();
+    authors.clear();
+    postKeys.clear();
+    publicBits.clear();
+    contentOffsets.assign(1, 0);
+    borrowedText = {};
+    contentText.clear();
+}
+
+Post PostStore::at(uint32_t row) const {
+    return Post(*this, row);
+}
+
+// Reads only the timestamp column and the visibility bitmap, and has no data-dependent branch:
+// every row is written to 'out' and the write position advances by the predicate.
+size_t PostStore::filter(const uint32_t* rows, size_t count, Ticks until, bool publicOnly, uint32_t* out) const {
+    const Ticks* time = times.data();
+    const uint64_t* bits = publicBits.data();
+    uint64_t anyVisibility = publicOnly ? 0 : 1;
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t row = rows[i];
+        uint64_t visible = ((bits[row / 64] >> (row % 64)) | anyVisibility) & 1;
+        out[kept] = row;
+        kept += static_cast<size_t>(time[row] <= until) & visible;
+    }
+    return kept;
+}
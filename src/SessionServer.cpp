@@ -0,0 +1,78 @@
+#include "SessionServer.h"
+#include "Fakebook.h"
+#include <sstream>
+
+SessionServer::SessionServer(FakeBook& _fakebook, unsigned threads)
+    : fakebook(_fakebook), workers(threads > 0 ? threads : 1) {}
+
+void SessionServer::reply(const std::string& text) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    *out << text;
+    out->flush();
+}
+
+// Runs the oldest pending command of 'session', then queues the session again if more arrived.
+void SessionServer::runNext(const std::string& name, Session& session) {
+    std::string line;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        line = std::move(session.pending.front());
+        session.pending.pop_front();
+    }
+
+    std::ostringstream text;
+    std::string_view fields[MAX_COMMAND_FIELDS];
+    BatchOp op;
+    if (!parseCommand(line, op, fields) ||
+        (session.state.user == nullptr && op != BatchOp::Login && op != BatchOp::SignUp)) {
+        text << name << "#ERROR#" << line << '\n';
+    } else {
+        std::vector<uint32_t> shown;
+        CommandResult result = executeCommand(fakebook, session.state, op, fields, shown);
+        text << name << (result == CommandResult::Ok ? "#OK#" : result == CommandResult::Busy ? "#BUSY#" : "#FAIL#")
+             << batchOpName(op) << '\n';
+        fakebook.writePosts(text, name + "#POST#", shown);
+    }
+    reply(text.str());
+    commandsRun.fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(sessionsMutex);
+    if (!session.pending.empty()) {
+        workers.submit([this, &name, &session]() { runNext(name, session); });
+        return;
+    }
+    session.scheduled = false;
+    if (--scheduledSessions == 0)
+        allIdle.notify_all();
+}
+
+void SessionServer::serve(std::istream& in, std::ostream& _out) {
+    out = &_out;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || line.compare(0, 2, "//") == 0)
+            continue;
+        size_t separator = line.find('#');
+        if (separator == std::string::npos || separator == 0) {
+            reply("#ERROR#" + line + "\n");
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        // unordered_map nodes never move, so the queued task can hold on to the key and the value
+        auto [it, inserted] = sessions.try_emplace(line.substr(0, separator));
+        Session& session = it->second;
+        session.pending.push_back(line.substr(separator + 1));
+        if (!session.scheduled) {
+            session.scheduled = true;
+            ++scheduledSessions;
+            const std::string& name = it->first;
+            workers.submit([this, &name, &session]() { runNext(name, session); });
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(sessionsMutex);
+    allIdle.wait(lock, [this]() { return scheduledSessions == 0; });
+}
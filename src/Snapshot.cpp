@@ -0,0 +1,208 @@
+#include "Snapshot.h"
+#include "User.h"
+#include "PostStore.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+const char SNAPSHOT_MAGIC[8] = {'F', 'B', 'S', 'N', 'A', 'P', '\0', '\0'};
+
+long long snapshotSeconds(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+}
+
+template <typename T>
+void writeRaw(std::ofstream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// The text section is written in the same order as the records, so the records can be written
+// first with running offsets and the text streamed afterwards without buffering it.
+uint32_t reserveString(uint64_t& nextOffset, std::string_view text) {
+    nextOffset += text.size();
+    return static_cast<uint32_t>(text.size());
+}
+
+bool writeSnapshot(const std::string& path, const std::vector<User*>& users, const PostStore& posts) {
+    std::string tempPath = path + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Error opening " << tempPath << " for writing." << std::endl;
+        return false;
+    }
+    std::unordered_map<const User*, uint32_t> indexOf;
+    indexOf.reserve(users.size());
+    for (uint32_t i = 0; i < users.size(); ++i)
+        indexOf.emplace(users[i], i);
+
+    std::vector<uint64_t> friendOffsets;
+    friendOffsets.reserve(users.size() + 1);
+    std::vector<uint32_t> friendIndices;
+    friendOffsets.push_back(0);
+    for (User* user : users) {
+        for (User* friendUser : user->getFriends())
+            friendIndices.push_back(indexOf.at(friendUser));
+        friendOffsets.push_back(friendIndices.size());
+    }
+
+    uint64_t stringBytes = 0;
+    std::vector<std::string> passwords(users.size());
+    std::vector<SnapshotUser> userRecords(users.size());
+    for (size_t i = 0; i < users.size(); ++i) {
+        User* user = users[i];
+        SnapshotUser& record = userRecords[i];
+        std::memset(&record, 0, sizeof(record));
+        record.textOffset = stringBytes;
+        record.userIdLength = reserveString(stringBytes, user->getUserId());
+        record.userNameLength = reserveString(stringBytes, user->getUserName());
+        record.emailLength = reserveString(stringBytes, user->getEmail());
+        passwords[i] = user->getCredential().stored();
+        record.passwordLength = reserveString(stringBytes, passwords[i]);
+        record.locationLength = reserveString(stringBytes, user->getLocation());
+        record.createdAt = snapshotSeconds(user->getCreatedAt());
+        record.age = user->getAge();
+        record.gender = user->getGender();
+        record.isPublic = user->isPublic();
+    }
+    std::vector<SnapshotPost> postRecords(posts.size());
+    for (uint32_t row = 0; row < posts.size(); ++row) {
+        SnapshotPost& record = postRecords[row];
+        std::memset(&record, 0, sizeof(record));
+        record.textOffset = stringBytes;
+        record.postIdLength = reserveString(stringBytes, posts.postId(row));
+    }
+    uint64_t contentStart = stringBytes;
+    for (uint32_t row = 0; row < posts.size(); ++row) {
+        SnapshotPost& record = postRecords[row];
+        record.contentOffset = stringBytes;
+        record.contentLength = reserveString(stringBytes, posts.content(row));
+        record.timestamp = snapshotSeconds(posts.timestamp(row));
+        record.authorIndex = indexOf.at(posts.author(row));
+        record.isPublic = posts.isPublic(row);
+    }
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.headerBytes = sizeof(SnapshotHeader);
+    header.userCount = users.size();
+    header.edgeCount = friendIndices.size();
+    header.postCount = posts.size();
+    header.stringBytes = stringBytes;
+    header.contentBytes = stringBytes - contentStart;
+    writeRaw(out, header);
+    out.write(reinterpret_cast<const char*>(userRecords.data()), userRecords.size() * sizeof(SnapshotUser));
+    out.write(reinterpret_cast<const char*>(friendOffsets.data()), friendOffsets.size() * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(friendIndices.data()), friendIndices.size() * sizeof(uint32_t));
+    if (friendIndices.size() % 2 != 0)
+        writeRaw(out, uint32_t{0}); // keep the post table 8-byte aligned
+    out.write(reinterpret_cast<const char*>(postRecords.data()), postRecords.size() * sizeof(SnapshotPost));
+
+    for (size_t i = 0; i < users.size(); ++i) {
+        User* user = users[i];
+        out << user->getUserId() << user->getUserName() << user->getEmail() << passwords[i] << user->getLocation();
+    }
+    for (uint32_t row = 0; row < posts.size(); ++row)
+        out << posts.postId(row);
+    for (uint32_t row = 0; row < posts.size(); ++row)
+        out << posts.content(row);
+    out.close();
+    if (!out) {
+        std::cerr << "Error writing snapshot " << tempPath << "." << std::endl;
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::cerr << "Error replacing " << path << ": " << error.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SnapshotReader::open(const std::string& path) {
+    file = MappedFile(path);
+    std::string_view bytes = file.view();
+    if (bytes.size() < sizeof(SnapshotHeader))
+        return false;
+    header = reinterpret_cast<const SnapshotHeader*>(bytes.data());
+    if (std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION || header->headerBytes != sizeof(SnapshotHeader)) {
+        return false;
+    }
+    // counts come from disk, so check them against the file size before trusting any pointer
+    uint64_t available = bytes.size() - sizeof(SnapshotHeader);
+    uint64_t edgeBytes = header->edgeCount * sizeof(uint32_t);
+    edgeBytes += edgeBytes % 8;
+    if (header->userCount > available / sizeof(SnapshotUser) || header->edgeCount > available ||
+        header->postCount > available / sizeof(SnapshotPost) || header->stringBytes > available ||
+        header->contentBytes > header->stringBytes) {
+        return false;
+    }
+    uint64_t needed = header->userCount * sizeof(SnapshotUser) + (header->userCount + 1) * sizeof(uint64_t) +
+                      edgeBytes + header->postCount * sizeof(SnapshotPost) + header->stringBytes;
+    if (needed != available)
+        return false;
+
+    const char* cursor = bytes.data() + sizeof(SnapshotHeader);
+    users = reinterpret_cast<const SnapshotUser*>(cursor);
+    cursor += header->userCount * sizeof(SnapshotUser);
+    friendOffsets = reinterpret_cast<const uint64_t*>(cursor);
+    cursor += (header->userCount + 1) * sizeof(uint64_t);
+    friendIndices = reinterpret_cast<const uint32_t*>(cursor);
+    cursor += edgeBytes;
+    posts = reinterpret_cast<const SnapshotPost*>(cursor);
+    cursor += header->postCount * sizeof(SnapshotPost);
+    strings = cursor;
+
+    auto validText = [this](uint64_t offset, uint64_t length) {
+        return offset <= header->stringBytes && length <= header->stringBytes - offset;
+    };
+    if (friendOffsets[0] != 0 || friendOffsets[header->userCount] != header->edgeCount)
+        return false;
+    for (uint64_t i = 0; i < header->userCount; ++i) {
+        const SnapshotUser& record = users[i];
+        uint64_t length = uint64_t{record.userIdLength} + record.userNameLength + record.emailLength +
+                          record.passwordLength + record.locationLength;
+        if (friendOffsets[i] > friendOffsets[i + 1] || !validText(record.textOffset, length))
+            return false;
+    }
+    for (uint64_t i = 0; i < header->edgeCount; ++i) {
+        if (friendIndices[i] >= header->userCount)
+            return false;
+    }
+    // the loader takes the content block as one run, so each post's content must follow the last
+    uint64_t nextContent = header->stringBytes - header->contentBytes;
+    for (uint64_t i = 0; i < header->postCount; ++i) {
+        const SnapshotPost& record = posts[i];
+        if (record.authorIndex >= header->userCount || !validText(record.textOffset, record.postIdLength) ||
+            record.contentOffset != nextContent || !validText(record.contentOffset, record.contentLength))
+            return false;
+        nextContent += record.contentLength;
+    }
+    if (nextContent != header->stringBytes)
+        return false;
+    return true;
+}
+
+SnapshotUserText SnapshotReader::userText(const SnapshotUser& record) const {
+    const char* cursor = strings + record.textOffset;
+    SnapshotUserText text;
+    text.userId = {cursor, record.userIdLength};
+    cursor += record.userIdLength;
+    text.userName = {cursor, record.userNameLength};
+    cursor += record.userNameLength;
+    text.email = {cursor, record.emailLength};
+    cursor += record.emailLength;
+    text.password = {cursor, record.passwordLength};
+    cursor += record.passwordLength;
+    text.location = {cursor, record.locationLength};
+    return text;
+}
+
+SnapshotPostText SnapshotReader::postText(const SnapshotPost& record) const {
+    return {{strings + record.textOffset, record.postIdLength}, {strings + record.contentOffset, record.contentLength}};
+}
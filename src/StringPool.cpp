@@ -0,0 +1,57 @@
+#include "StringPool.h"
+#include <cstring>
+#include <functional>
+
+// Strings longer than a block get a block of their own.
+std::string_view StringPool::store(std::string_view text) {
+    if (text.empty())
+        return {};
+    char* destination;
+    if (text.size() > BLOCK_SIZE) {
+        blocks.push_back(std::make_unique<char[]>(text.size()));
+        destination = blocks.back().get();
+        blockUsed = BLOCK_SIZE;
+    } else {
+        if (text.size() > BLOCK_SIZE - blockUsed) {
+            blocks.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+            blockUsed = 0;
+        }
+        destination = blocks.back().get() + blockUsed;
+        blockUsed += text.size();
+    }
+    std::memcpy(destination, text.data(), text.size());
+    storedBytes += text.size();
+    return {destination, text.size()};
+}
+
+uint32_t StringPool::intern(std::string_view text) {
+    auto it = keys.find(text);
+    if (it != keys.end())
+        return it->second;
+    auto inside = std::less_equal<const char*>();
+    bool isBorrowed = inside(borrowed.data(), text.data()) && inside(text.data() + text.size(), borrowed.data() + borrowed.size());
+    std::string_view stored = isBorrowed ? text : store(text);
+    uint32_t key = static_cast<uint32_t>(texts.size());
+    texts.push_back(stored);
+    keys.emplace(stored, key);
+    return key;
+}
+
+uint32_t StringPool::find(std::string_view text) const {
+    auto it = keys.find(text);
+    return it == keys.end() ? NOT_FOUND : it->second;
+}
+
+void StringPool::reserve(size_t count) {
+    texts.reserve(count);
+    keys.reserve(count);
+}
+
+void StringPool::clear() {
+    keys.clear();
+    texts.clear();
+    blocks.clear();
+    borrowed = {};
+    blockUsed = BLOCK_SIZE;
+    storedBytes = 0;
+}
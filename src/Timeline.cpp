@@ -0,0 +1,351 @@
+#include "Timeline.h"
+#include "Metrics.h"
+#include "User.h"
+#include "PostStore.h"
+#include <algorithm>
+
+// New posts are almost always the newest, so this is usually a push_back. Rows are unique in
+// feed order, so an equal neighbour is the same post arriving through a second path.
+void FeedBuffer::insert(const PostStore& store, uint32_t row, size_t capacity) {
+    auto position = std::upper_bound(posts.begin(), posts.end(), row,
+                                     [&store](uint32_t a, uint32_t b) { return store.isOlder(a, b); });
+    if (position != posts.begin() && *(position - 1) == row)
+        return;
+    if (posts.size() >= capacity && position == posts.begin()) {
+        truncated = true;
+        return;
+    }
+    posts.insert(position, row);
+    if (posts.size() > capacity) {
+        posts.erase(posts.begin());
+        truncated = true;
+    }
+}
+
+void FeedBuffer::assign(std::vector<uint32_t> newestFirst, bool hasOlder) {
+    std::reverse(newestFirst.begin(), newestFirst.end());
+    posts = std::move(newestFirst);
+    truncated = hasOlder;
+}
+
+FeedSource feedSourceAfter(const PostStore& store, const std::vector<uint32_t>& posts, const FeedCursor& cursor,
+                           uint32_t skipAuthor = FeedSource::NO_AUTHOR, bool truncated = false) {
+    size_t remaining = posts.size();
+    if (!cursor.atStart) {
+        auto end = std::partition_point(posts.begin(), posts.end(), [&store, &cursor](uint32_t row) {
+            if (store.ticks(row) != cursor.ticks)
+                return store.ticks(row) < cursor.ticks;
+            return row > cursor.row;
+        });
+        remaining = static_cast<size_t>(end - posts.begin());
+    }
+    return {&posts, remaining, skipAuthor, truncated};
+}
+
+void skipHiddenPosts(const PostStore& store, FeedSource& source) {
+    while (source.remaining > 0 && store.authorIndex((*source.posts)[source.remaining - 1]) == source.skipAuthor)
+        --source.remaining;
+}
+
+// The same post can reach a feed through several sources; copies are the same row, so they
+// come out of the merge back to back.
+bool alreadyInPage(const std::vector<uint32_t>& pagePosts, uint32_t row) {
+    return !pagePosts.empty() && pagePosts.back() == row;
+}
+
+/* k-way merge of 'sources' into page.posts, newest first, stopping after 'limit' posts. The heap
+   holds one entry per non-empty source. Returns false if a truncated source ran dry before the
+   page was full, since posts older than that point may be missing. */
+bool mergeFeedSources(const PostStore& store, std::vector<FeedSource>& sources, std::vector<size_t>& heap, size_t limit,
+                      FeedPage& page) {
+    auto headOf = [&sources](size_t index) {
+        const FeedSource& source = sources[index];
+        return (*source.posts)[source.remaining - 1];
+    };
+    auto olderHead = [&store, &headOf](size_t a, size_t b) {
+        return store.isOlder(headOf(a), headOf(b));
+    };
+
+    heap.clear();
+    page.posts.reserve(limit);
+    for (size_t i = 0; i < sources.size(); ++i) {
+        skipHiddenPosts(store, sources[i]);
+        if (sources[i].remaining > 0)
+            heap.push_back(i);
+        else if (sources[i].truncated)
+            return false;
+    }
+    std::make_heap(heap.begin(), heap.end(), olderHead);
+
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), olderHead);
+        FeedSource& source = sources[heap.back()];
+        uint32_t row = headOf(heap.back());
+        if (!alreadyInPage(page.posts, row)) {
+            if (page.posts.size() == limit) {
+                page.hasMore = true;
+                return true;
+            }
+            page.posts.push_back(row);
+        }
+        --source.remaining;
+        skipHiddenPosts(store, source);
+        if (source.remaining > 0) {
+            std::push_heap(heap.begin(), heap.end(), olderHead);
+            continue;
+        }
+        heap.pop_back();
+        if (source.truncated) {
+            if (page.posts.size() < limit)
+                return false;
+            page.hasMore = true;
+            return true;
+        }
+    }
+    return true;
+}
+
+// The merge's working space. It is per thread so concurrent queries don't share it, and reused so
+// a warm read allocates per page, never per post or per author.
+struct FeedScratch {
+    std::vector<FeedSource> sources;
+    std::vector<size_t> mergeHeap;
+    std::vector<const FeedBuffer*> hubs;
+    std::vector<uint32_t> visitMarks; // per graph index, == visitEpoch once seen in this pass
+    uint32_t visitEpoch = 0;
+
+    // Epoch-stamped visited set over graph indices: starting a pass is O(1) instead of clearing.
+    void beginVisit() {
+        if (++visitEpoch == 0) {
+            std::fill(visitMarks.begin(), visitMarks.end(), 0);
+            visitEpoch = 1;
+        }
+    }
+
+    bool firstVisit(const User* user) {
+        uint32_t index = user->getGraphIndex();
+        if (index >= visitMarks.size())
+            visitMarks.resize(index + 1, 0);
+        if (visitMarks[index] == visitEpoch)
+            return false;
+        visitMarks[index] = visitEpoch;
+        return true;
+    }
+};
+
+FeedScratch& feedScratch() {
+    thread_local FeedScratch scratch;
+    return scratch;
+}
+
+TimelineService::TimelineService(const PostStore& _store, size_t _capacity, size_t _celebrityThreshold)
+    : store(_store), capacity(_capacity), celebrityThreshold(_celebrityThreshold) {
+}
+
+bool TimelineService::isCelebrity(const User* user) const {
+    return user->friendCount() > celebrityThreshold;
+}
+
+TimelineService::Shard& TimelineService::shardOf(const User* user) {
+    return shards[user->getGraphIndex() % SHARDS];
+}
+
+// Writer-side lookup of an existing buffer; writers run alone, so no shard mutex is taken.
+FeedBuffer* TimelineService::findBuffer(std::unordered_map<const User*, FeedBuffer> Shard::*map, const User* user) {
+    std::unordered_map<const User*, FeedBuffer>& buffers = shardOf(user).*map;
+    auto it = buffers.find(user);
+    return it != buffers.end() ? &it->second : nullptr;
+}
+
+void TimelineService::onPostCreated(uint32_t row) {
+    User* author = store.author(row);
+    if (isCelebrity(author))
+        return; // pulled by readers
+    for (User* friendUser : author->getFriends()) {
+        if (FeedBuffer* own = findBuffer(&Shard::timelines, friendUser))
+            own->insert(store, row, capacity);
+        if (!store.isPublic(row))
+            continue;
+        if (isCelebrity(friendUser)) {
+            if (FeedBuffer* hub = findBuffer(&Shard::hubTimelines, friendUser))
+                hub->insert(store, row, capacity);
+            continue;
+        }
+        for (User* friendOfFriend : friendUser->getFriends()) {
+            if (friendOfFriend == author)
+                continue;
+            if (FeedBuffer* theirs = findBuffer(&Shard::timelines, friendOfFriend))
+                theirs->insert(store, row, capacity);
+        }
+    }
+}
+
+// Drops every buffer whose contents depend on the edge between user and other. If either side
+// crossed the celebrity threshold the push/pull split itself changed, so everything is rebuilt.
+void TimelineService::onFriendshipChanged(User* user, User* other) {
+    for (User* endpoint : {user, other}) {
+        size_t degree = endpoint->friendCount();
+        if (degree == celebrityThreshold || degree == celebrityThreshold + 1) {
+            clear();
+            return;
+        }
+    }
+    for (User* endpoint : {user, other}) {
+        Shard& shard = shardOf(endpoint);
+        shard.timelines.erase(endpoint);
+        shard.hubTimelines.erase(endpoint);
+        shard.celebrityFriends.erase(endpoint);
+        for (User* friendUser : endpoint->getFriends())
+            shardOf(friendUser).timelines.erase(friendUser);
+    }
+}
+
+void TimelineService::clear() {
+    for (Shard& shard : shards) {
+        shard.timelines.clear();
+        shard.hubTimelines.clear();
+        shard.celebrityFriends.clear();
+    }
+}
+
+// Pull-builds the pushed part of a feed: posts by regular friends, and public posts by regular
+// friends-of-friends reached through a regular friend. Same rules as onPostCreated. The merge runs
+// outside the shard mutex; if another reader built the same buffer meanwhile, theirs is kept.
+FeedBuffer& TimelineService::timelineOf(User* viewer) {
+    Shard& shard = shardOf(viewer);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.timelines.find(viewer);
+        if (it != shard.timelines.end())
+            return it->second;
+    }
+
+    ScopedTimer timer(Timer::FeedBuild);
+    FeedScratch& scratch = feedScratch();
+    FeedCursor start;
+    scratch.sources.clear();
+    scratch.beginVisit();
+    for (User* friendUser : viewer->getFriends()) {
+        if (isCelebrity(friendUser))
+            continue;
+        scratch.sources.push_back(feedSourceAfter(store, friendUser->postsByTime(), start));
+        for (User* friendOfFriend : friendUser->getFriends()) {
+            if (friendOfFriend == viewer || isCelebrity(friendOfFriend) || !scratch.firstVisit(friendOfFriend))
+                continue;
+            scratch.sources.push_back(feedSourceAfter(store, friendOfFriend->publicPostsByTime(), start));
+        }
+    }
+    FeedPage newest;
+    mergeFeedSources(store, scratch.sources, scratch.mergeHeap, capacity, newest);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto [it, inserted] = shard.timelines.try_emplace(viewer);
+    if (inserted)
+        it->second.assign(std::move(newest.posts), newest.hasMore);
+    return it->second;
+}
+
+// Public posts by the regular friends of a celebrity, i.e. what a normal friend would have fanned
+// out to the celebrity's friends one by one.
+FeedBuffer& TimelineService::hubTimelineOf(User* hub) {
+    Shard& shard = shardOf(hub);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.hubTimelines.find(hub);
+        if (it != shard.hubTimelines.end())
+            return it->second;
+    }
+
+    FeedScratch& scratch = feedScratch();
+    FeedCursor start;
+    scratch.sources.clear();
+    for (User* friendUser : hub->getFriends()) {
+        if (!isCelebrity(friendUser))
+            scratch.sources.push_back(feedSourceAfter(store, friendUser->publicPostsByTime(), start));
+    }
+    FeedPage newest;
+    mergeFeedSources(store, scratch.sources, scratch.mergeHeap, capacity, newest);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto [it, inserted] = shard.hubTimelines.try_emplace(hub);
+    if (inserted)
+        it->second.assign(std::move(newest.posts), newest.hasMore);
+    return it->second;
+}
+
+const std::vector<User*>& TimelineService::celebrityFriendsOf(User* user) {
+    Shard& shard = shardOf(user);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto [it, inserted] = shard.celebrityFriends.try_emplace(user);
+    if (inserted) {
+        for (User* friendUser : user->getFriends()) {
+            if (isCelebrity(friendUser))
+                it->second.push_back(friendUser);
+        }
+    }
+    return it->second;
+}
+
+// The pushed buffer merged with what is pulled from celebrity friends, celebrity
+// friends-of-friends and the hub buffers of celebrity friends. Fails once the page reaches past
+// what a bounded buffer holds.
+bool TimelineService::queryFromBuffers(User* viewer, size_t limit, const FeedCursor& cursor, FeedPage& page) {
+    // lazy builds reuse the scratch vectors, so they all happen before the sources are gathered
+    FeedScratch& scratch = feedScratch();
+    FeedBuffer& pushed = timelineOf(viewer);
+    scratch.hubs.clear();
+    for (User* friendUser : viewer->getFriends()) {
+        if (isCelebrity(friendUser))
+            scratch.hubs.push_back(&hubTimelineOf(friendUser));
+    }
+
+    scratch.sources.clear();
+    scratch.sources.push_back(feedSourceAfter(store, pushed.oldestFirst(), cursor, FeedSource::NO_AUTHOR, pushed.isTruncated()));
+    scratch.beginVisit();
+    size_t nextHub = 0;
+    for (User* friendUser : viewer->getFriends()) {
+        if (isCelebrity(friendUser)) {
+            const FeedBuffer& hub = *scratch.hubs[nextHub++];
+            scratch.sources.push_back(feedSourceAfter(store, friendUser->postsByTime(), cursor));
+            scratch.sources.push_back(feedSourceAfter(store, hub.oldestFirst(), cursor, viewer->getGraphIndex(), hub.isTruncated()));
+        }
+        for (User* celebrity : celebrityFriendsOf(friendUser)) {
+            if (celebrity != viewer && scratch.firstVisit(celebrity))
+                scratch.sources.push_back(feedSourceAfter(store, celebrity->publicPostsByTime(), cursor));
+        }
+    }
+    return mergeFeedSources(store, scratch.sources, scratch.mergeHeap, limit, page);
+}
+
+// Deep pages: merge every friend's posts and every friend-of-friend's public posts directly.
+void TimelineService::queryFromAuthors(User* viewer, size_t limit, const FeedCursor& cursor, FeedPage& page) {
+    FeedScratch& scratch = feedScratch();
+    scratch.sources.clear();
+    scratch.beginVisit();
+    for (User* friendUser : viewer->getFriends()) {
+        scratch.sources.push_back(feedSourceAfter(store, friendUser->postsByTime(), cursor));
+        for (User* friendOfFriend : friendUser->getFriends()) {
+            if (friendOfFriend != viewer && scratch.firstVisit(friendOfFriend))
+                scratch.sources.push_back(feedSourceAfter(store, friendOfFriend->publicPostsByTime(), cursor));
+        }
+    }
+    mergeFeedSources(store, scratch.sources, scratch.mergeHeap, limit, page);
+}
+
+// The next 'limit' posts of the viewer's feed after 'cursor', newest first.
+FeedPage TimelineService::queryFeed(User* viewer, size_t limit, const FeedCursor& cursor) {
+    FeedPage page;
+    if (!queryFromBuffers(viewer, limit, cursor, page)) {
+        page.posts.clear();
+        page.hasMore = false;
+        queryFromAuthors(viewer, limit, cursor, page);
+    }
+    page.next = cursor;
+    if (!page.posts.empty()) {
+        uint32_t last = page.posts.back();
+        page.next.atStart = false;
+        page.next.ticks = store.ticks(last);
+        page.next.row = last;
+    }
+    return page;
+}
@@ -1,77 +1,106 @@
 #include "User.h"
-#include "Post.h"
+#include "PostStore.h"
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <vector>
-#include <list>
 #include <chrono>
 #include <algorithm>
 #include <limits>
-#include <set>
+#include <utility>
 
 void clearCinUser() {
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 }
 
-User::User(std::string uName, std::string uId, std::string _email, std::string _password, int _age,
-           char _gender, std::string _location, bool _isPublicProfile, std::chrono::system_clock::time_point _createdAt)
-    : userName(uName),
-      userId(uId),
-      email(_email),
-      password(_password),
+User::User(StringPool& pool, std::string_view uName, std::string_view uId, std::string_view _email, Credential _credential,
+           int _age, char _gender, std::string_view _location, bool _isPublicProfile,
+           std::chrono::system_clock::time_point _createdAt)
+    : strings(&pool),
+      userIdKey(pool.intern(uId)),
+      userNameKey(pool.intern(uName)),
+      emailKey(pool.intern(_email)),
+      locationKey(pool.intern(_location)),
+      credential(std::move(_credential)),
       age(_age),
       gender(_gender),
-      location(_location),
       isPublicProfile(_isPublicProfile),
       createdAt(_createdAt) {
 }
 
-void User::viewOwnProfile() {
+// Posts are kept oldest first so feeds can merge them newest first from the back. A new post is
+// almost always the newest, so this is normally a push_back.
+void User::addPost(const PostStore& store, uint32_t row) {
+    auto isOlder = [&store](uint32_t a, uint32_t b) { return store.isOlder(a, b); };
+    posts.insert(std::upper_bound(posts.begin(), posts.end(), row, isOlder), row);
+    if (store.isPublic(row))
+        publicPosts.insert(std::upper_bound(publicPosts.begin(), publicPosts.end(), row, isOlder), row);
+}
+
+// Bulk loads append in file order and call sortPostsByTime() once at the end.
+void User::addLoadedPost(uint32_t row) {
+    posts.push_back(row);
+}
+
+void User::sortPostsByTime(const PostStore& store) {
+    std::sort(posts.begin(), posts.end(), [&store](uint32_t a, uint32_t b) { return store.isOlder(a, b); });
+    publicPosts.resize(posts.size());
+    publicPosts.resize(store.filter(posts.data(), posts.size(), std::numeric_limits<PostStore::Ticks>::max(), true,
+                                    publicPosts.data()));
+    publicPosts.shrink_to_fit();
+}
+
+void User::writeUserLine(std::ostream& out) const {
+    out << getUserId() << '#' << getUserName() << '#' << getEmail() << '#' << credential.stored() << '#' << getLocation()
+        << '#' << gender << '#' << age << '#' << (isPublic() ? "Public" : "Private") << '#'
+        << std::chrono::duration_cast<std::chrono::seconds>(createdAt.time_since_epoch()).count();
+}
+
+void User::writeFriendLine(std::ostream& out) const {
+    out << getUserId() << ':';
+    bool first = true;
+    for (User* friendUser : getFriends()) {
+        if (!first)
+            out << ',';
+        out << friendUser->getUserId();
+        first = false;
+    }
+}
+
+void User::viewOwnProfile(const PostStore& store) {
     std::cout << "\n--- Your Profile ---" << std::endl;
-    std::cout << "Username: " << this->userName << " (ID: " << this->userId << ")" << std::endl;
-    std::cout << "Email: " << this->email << std::endl;
-    std::cout << "Location: " << this->location << std::endl;
+    std::cout << "Username: " << getUserName() << " (ID: " << getUserId() << ")" << std::endl;
+    std::cout << "Email: " << getEmail() << std::endl;
+    std::cout << "Location: " << getLocation() << std::endl;
     std::cout << "Age: " << this->age << "  Gender: " << this->gender << std::endl;
-    std::cout << "Profile Status: " << (this->isPublicProfile ? "Public" : "Private") << std::endl;
+    std::cout << "Profile Status: " << (isPublic() ? "Public" : "Private") << std::endl;
 
-    std::cout << "\n--- Your Friends (" << this->friends.size() << ") ---" << std::endl;
-    for (User* friendUser : this->friends) {
+    std::cout << "\n--- Your Friends (" << friendCount() << ") ---" << std::endl;
+    for (User* friendUser : getFriends()) {
         std::cout << "- " << friendUser->getUserName() << std::endl;
     }
 
     std::cout << "\n--- Your Posts (" << this->posts.size() << ") ---" << std::endl;
-    for (Post* post : this->posts) {
-        // post->displayPost();
-        std::cout << "  [" << post->getPostId() << "] " << post->getContent() << std::endl;
+    for (uint32_t row : this->posts) {
+        // store.at(row).displayPost();
+        std::cout << "  [" << store.postId(row) << "] " << store.content(row) << std::endl;
     }
     std::cout << "--------------------" << std::endl;
 }
 
-void User::viewOtherProfile(User* otherUser) {
-    if (otherUser == nullptr) return;
-
-    auto isFriend = [this](User* other) {
-        for (User* f : this->friends) {
-            if (f == other) return true;
-        }
-        return false;
-    };
+void User::viewOtherProfile(const ProfileView& profile, const PostStore& store) {
+    if (profile.user == nullptr) return;
 
-    bool canViewFullProfile = otherUser->isPublic() || isFriend(otherUser);
+    std::cout << "\n--- " << profile.user->getUserName() << "'s Profile ---" << std::endl;
+    std::cout << "Location: " << profile.user->getLocation() << std::endl;
 
-    std::cout << "\n--- " << otherUser->getUserName() << "'s Profile ---" << std::endl;
-    std::cout << "Location: " << otherUser->location << std::endl;
+    if (profile.fullAccess) {
+        std::cout << "Age: " << profile.user->age << "  Gender: " << profile.user->gender << std::endl;
+        std::cout << "\n--- " << profile.user->getUserName() << "'s Posts ---" << std::endl;
 
-    if (canViewFullProfile) {
-        std::cout << "Age: " << otherUser->age << "  Gender: " << otherUser->gender << std::endl;
-        std::cout << "\n--- " << otherUser->getUserName() << "'s Posts ---" << std::endl;
-
-        for (Post* post : otherUser->getPosts()) {
-            if (post->isPublic() || isFriend(otherUser)) {
-                // post->displayPost();
-                std::cout << "  [" << post->getPostId() << "] " << post->getContent() << std::endl;
-            }
+        for (uint32_t row : profile.posts) {
+            // store.at(row).displayPost();
+            std::cout << "  [" << store.postId(row) << "] " << store.content(row) << std::endl;
         }
     } else {
         std::cout << "\nThis profile is private and you are not friends." << std::endl;
@@ -79,7 +108,8 @@ void User::viewOtherProfile(User* otherUser) {
     std::cout << "--------------------" << std::endl;
 }
 
-void User::changePrivacySetting() {
+// Returns true for public; FakeBook::setPrivacy applies it.
+bool User::promptPrivacySetting() {
     char choice = ' ';
     while (choice != 'P' && choice != 'V') {
         std::cout << "Set your profile to (P)ublic or (V)rivate? ";
@@ -87,11 +117,10 @@ void User::changePrivacySetting() {
         choice = toupper(choice);
         clearCinUser();
     }
-    this->isPublicProfile = (choice == 'P');
-    std::cout << "Your profile is now " << (this->isPublicProfile ? "Public." : "Private.") << std::endl;
+    return choice == 'P';
 }
 
-Post* User::createPost() {
+PostDraft User::promptNewPost() {
     std::string content;
     char privacyChoice = ' ';
 
@@ -104,62 +133,25 @@ Post* User::createPost() {
         privacyChoice = toupper(privacyChoice);
         clearCinUser();
     }
-    bool isPostPublic = (privacyChoice == 'P');
-
-    auto now = std::chrono::system_clock::now();
-    long long timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
-    std::string postId = "p" + std::to_string(timestamp);
-
-    Post* newPost = new Post(this, content, now, isPostPublic, postId);
-    this->addPost(newPost);
-
-    std::cout << "Post created successfully!" << std::endl;
-    return newPost;
+    return {std::move(content), privacyChoice == 'P'};
 }
 
 
-struct PostComparator {
-    bool operator()(Post* a, Post* b) {
-        return a->getTimestamp() < b->getTimestamp();
-    }
-};
-
-void User::viewFeed() {
-    std::cout << "Building your home feed..." << std::endl;
-    std::set<Post*> uniquePosts;
-    for (User* friendUser : this->friends) {
-        for (Post* post : friendUser->getPosts()) {
-            uniquePosts.insert(post);
-        }
-    }
-
-    for (User* friendUser : this->friends) {
-        for (User* friendOfFriend : friendUser->getFriends()) {
-            if (friendOfFriend == this) continue;
-            for (Post* post : friendOfFriend->getPosts()) {
-                if (post->isPublic()) {
-                    uniquePosts.insert(post);
-                }
-            }
-        }
-    }
-
-    if (uniquePosts.empty()) {
-        std::cout << "Your feed is empty." << std::endl;
+void User::viewFeed(const PostStore& store, const std::vector<uint32_t>& feedPosts, size_t pageNumber) {
+    if (feedPosts.empty()) {
+        std::cout << (pageNumber == 1 ? "Your feed is empty." : "No more posts.") << std::endl;
         return;
     }
 
-    std::vector<Post*> feedPosts(uniquePosts.begin(), uniquePosts.end());
-    std::make_heap(feedPosts.begin(), feedPosts.end(), PostComparator());
-    std::sort_heap(feedPosts.begin(), feedPosts.end(), PostComparator());
-
-    std::cout << "\n--- Your Home Feed (Newest First) ---" << std::endl;
-    for (auto it = feedPosts.rbegin(); it != feedPosts.rend(); ++it) {
-        Post* post = *it;
-        // post->displayPost();
+    if (pageNumber == 1)
+        std::cout << "\n--- Your Home Feed (Newest First) ---" << std::endl;
+    else
+        std::cout << "\n--- Home Feed, page " << pageNumber << " ---" << std::endl;
+    for (uint32_t row : feedPosts) {
+        // store.at(row).displayPost();
         std::cout << "--------------------" << std::endl;
-        std::cout << "Post by: " << post->getAuthor()->getUserName() << std::endl;
-        std::cout << post->getContent() << std::endl;
+        std::cout << "Post by: " << store.author(row)->getUserName() << std::endl;
+        std::cout << store.content(row) << std::endl;
     }
     std::cout << "--------------------" << std::endl;
 }
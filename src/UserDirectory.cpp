@@ -0,0 +1,51 @@
+#include "UserDirectory.h"
+#include "StringPool.h"
+#include "User.h"
+
+UserDirectory::UserDirectory(const StringPool& _strings) : strings(_strings) {
+}
+
+// Claims 'key' for 'user' unless another user already has it.
+bool claimKey(std::vector<User*>& index, uint32_t key, User* user) {
+    if (key >= index.size())
+        index.resize(key + 1, nullptr);
+    if (index[key] != nullptr)
+        return false;
+    index[key] = user;
+    return true;
+}
+
+// Returns false if the userId is already taken. Duplicate usernames/emails keep the first user,
+// which is what the old linear scans returned.
+bool UserDirectory::add(User* user) {
+    if (!claimKey(byId, user->getUserIdKey(), user))
+        return false;
+    claimKey(byUsername, user->getUserNameKey(), user);
+    claimKey(byEmail, user->getEmailKey(), user);
+    ++count;
+    return true;
+}
+
+void UserDirectory::clear() {
+    byId.clear();
+    byUsername.clear();
+    byEmail.clear();
+    count = 0;
+}
+
+User* UserDirectory::findByKey(const std::vector<User*>& index, std::string_view text) const {
+    uint32_t key = strings.find(text);
+    return key < index.size() ? index[key] : nullptr;
+}
+
+User* UserDirectory::findById(std::string_view userId) const {
+    return findByKey(byId, userId);
+}
+
+User* UserDirectory::findByUsername(std::string_view username) const {
+    return findByKey(byUsername, username);
+}
+
+User* UserDirectory::findByEmail(std::string_view email) const {
+    return findByKey(byEmail, email);
+}
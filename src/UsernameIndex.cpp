@@ -0,0 +1,425 @@
+#include "UsernameIndex.h"
+#include "User.h"
+#include <algorithm>
+#include <numeric>
+
+const uint32_t NO_NAME = UINT32_MAX;
+const uint32_t NO_TRIE_NODE = UINT32_MAX;
+
+char foldUsernameChar(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+std::string UsernameIndex::fold(std::string_view name) {
+    std::string folded(name);
+    for (char& c : folded)
+        c = foldUsernameChar(c);
+    return folded;
+}
+
+uint32_t UsernameIndex::maxEditsFor(size_t length) {
+    return length < 3 ? 0 : length < 6 ? 1 : 2;
+}
+
+// Optimal string alignment distance (Levenshtein plus adjacent swaps) between 'typed' and each
+// prefix of 'name', one row per name character, stopping once every cell is over 'maxEdits'.
+uint32_t UsernameIndex::prefixDistance(std::string_view typed, std::string_view name, uint32_t maxEdits) {
+    typed = typed.substr(0, MAX_TYPED);
+    size_t m = typed.size();
+    uint32_t rows[3][MAX_TYPED + 1];
+    uint32_t* before = rows[0];
+    uint32_t* previous = rows[1];
+    uint32_t* current = rows[2];
+    for (size_t j = 0; j <= m; ++j)
+        previous[j] = static_cast<uint32_t>(j);
+    uint32_t best = previous[m];
+    for (size_t i = 1; i <= name.size() && best > 0; ++i) {
+        char c = foldUsernameChar(name[i - 1]);
+        current[0] = static_cast<uint32_t>(i);
+        uint32_t smallest = current[0];
+        for (size_t j = 1; j <= m; ++j) {
+            uint32_t cost = std::min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + (typed[j - 1] != c)});
+            if (i > 1 && j > 1 && typed[j - 2] == c && typed[j - 1] == foldUsernameChar(name[i - 2]))
+                cost = std::min(cost, before[j - 2] + 1);
+            current[j] = cost;
+            smallest = std::min(smallest, cost);
+        }
+        best = std::min(best, current[m]);
+        if (smallest > maxEdits)
+            break;
+        std::swap(before, previous);
+        std::swap(previous, current);
+    }
+    return best <= maxEdits ? best : UINT32_MAX;
+}
+
+void UsernameIndex::build(const std::vector<User*>& allUsers) {
+    clear();
+    std::string foldedText;
+    std::vector<uint32_t> foldedOffsets{0};
+    foldedOffsets.reserve(allUsers.size() + 1);
+    for (const User* user : allUsers) {
+        for (char c : user->getUserName())
+            foldedText.push_back(foldUsernameChar(c));
+        foldedOffsets.push_back(static_cast<uint32_t>(foldedText.size()));
+    }
+    auto foldedAt = [&](uint32_t i) {
+        return std::string_view(foldedText).substr(foldedOffsets[i], foldedOffsets[i + 1] - foldedOffsets[i]);
+    };
+    std::vector<uint32_t> order(allUsers.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        int byName = foldedAt(a).compare(foldedAt(b));
+        return byName != 0 ? byName < 0 : a < b;
+    });
+
+    nameText.reserve(foldedText.size());
+    nameOffsets.reserve(allUsers.size() + 1);
+    users.reserve(allUsers.size());
+    popularity.reserve(allUsers.size());
+    for (uint32_t i : order) {
+        nameText.append(foldedAt(i));
+        nameOffsets.push_back(static_cast<uint32_t>(nameText.size()));
+        users.push_back(allUsers[i]);
+        popularity.push_back(static_cast<uint32_t>(allUsers[i]->friendCount()));
+    }
+    buildTrieNodes();
+    buildTopLevels();
+}
+
+// End of the run of names in [lo, hi) with the same byte at 'depth' as name 'lo': gallop, then
+// binary search, so a child costs the log of its size.
+template <typename NameAt>
+uint32_t usernameChildEnd(const NameAt& nameAt, size_t depth, uint32_t lo, uint32_t hi) {
+    char c = nameAt(lo)[depth];
+    uint32_t end = lo + 1, step = 1;
+    while (end < hi && nameAt(end)[depth] == c) {
+        uint32_t probe = std::min<uint32_t>(hi, end + step);
+        if (nameAt(probe - 1)[depth] != c) {
+            uint32_t first = end, last = probe - 1;
+            while (first < last) {
+                uint32_t mid = first + (last - first) / 2;
+                if (nameAt(mid)[depth] == c)
+                    first = mid + 1;
+                else
+                    last = mid;
+            }
+            return first;
+        }
+        end = probe;
+        step *= 2;
+    }
+    return end;
+}
+
+// Breadth first from the root, listing the children of every node over EXPLICIT_NODE_NAMES names.
+void UsernameIndex::buildTrieNodes() {
+    auto names = [this](uint32_t i) { return nameAt(i); };
+    trieNodes.push_back({0, static_cast<uint32_t>(users.size()), 0, 0, 0});
+    std::vector<uint32_t> depths{0};
+    for (size_t node = 0; node < trieNodes.size(); ++node) {
+        uint32_t lo = trieNodes[node].lo, hi = trieNodes[node].hi, depth = depths[node];
+        if (hi - lo < EXPLICIT_NODE_NAMES)
+            continue;
+        while (lo < hi && nameAt(lo).size() == depth) // names that end here sort first
+            ++lo;
+        trieNodes[node].firstChild = static_cast<uint32_t>(trieNodes.size());
+        while (lo < hi) {
+            uint32_t end = usernameChildEnd(names, depth, lo, hi);
+            trieNodes.push_back({lo, end, 0, 0, nameAt(lo)[depth]});
+            depths.push_back(depth + 1);
+            lo = end;
+        }
+        trieNodes[node].childCount = static_cast<uint32_t>(trieNodes.size()) - trieNodes[node].firstChild;
+    }
+}
+
+// Each level's group keeps the best TOP_PER_GROUP of its FANOUT children's lists, so it holds
+// exactly the best of its whole range.
+void UsernameIndex::buildTopLevels() {
+    std::vector<uint32_t> candidates;
+    size_t childCount = users.size();
+    const std::vector<uint32_t>* children = nullptr; // nullptr: the children are the names themselves
+    while (childCount > 1 || children == nullptr) {
+        size_t groupCount = (childCount + FANOUT - 1) / FANOUT;
+        std::vector<uint32_t> level(groupCount * TOP_PER_GROUP, NO_NAME);
+        for (size_t g = 0; g < groupCount; ++g) {
+            candidates.clear();
+            size_t end = std::min(childCount, (g + 1) * FANOUT);
+            for (size_t child = g * FANOUT; child < end; ++child) {
+                if (children == nullptr) {
+                    candidates.push_back(static_cast<uint32_t>(child));
+                    continue;
+                }
+                for (size_t slot = 0; slot < TOP_PER_GROUP && (*children)[child * TOP_PER_GROUP + slot] != NO_NAME; ++slot)
+                    candidates.push_back((*children)[child * TOP_PER_GROUP + slot]);
+            }
+            size_t kept = std::min(candidates.size(), TOP_PER_GROUP);
+            std::partial_sort(candidates.begin(), candidates.begin() + static_cast<std::ptrdiff_t>(kept), candidates.end(),
+                              [this](uint32_t a, uint32_t b) { return morePopular(a, b); });
+            std::copy(candidates.begin(), candidates.begin() + static_cast<std::ptrdiff_t>(kept),
+                      level.begin() + static_cast<std::ptrdiff_t>(g * TOP_PER_GROUP));
+        }
+        topLevels.push_back(std::move(level));
+        children = &topLevels.back();
+        childCount = groupCount;
+        if (groupCount == 0)
+            break;
+    }
+}
+
+// 'best' is a heap with the least popular kept name on top.
+void UsernameIndex::offer(uint32_t index, size_t want, std::vector<uint32_t>& best) const {
+    auto lessPopular = [this](uint32_t a, uint32_t b) { return morePopular(a, b); };
+    if (best.size() < want) {
+        best.push_back(index);
+        std::push_heap(best.begin(), best.end(), lessPopular);
+    } else if (morePopular(index, best.front())) {
+        std::pop_heap(best.begin(), best.end(), lessPopular);
+        best.back() = index;
+        std::push_heap(best.begin(), best.end(), lessPopular);
+    }
+}
+
+void UsernameIndex::collectTop(size_t levels, uint32_t lo, uint32_t hi, size_t want, std::vector<uint32_t>& best) const {
+    if (lo >= hi)
+        return;
+    if (levels == 0) {
+        for (uint32_t i = lo; i < hi; ++i)
+            offer(i, want, best);
+        return;
+    }
+    uint64_t groupSize = 1;
+    for (size_t i = 0; i < levels; ++i)
+        groupSize *= FANOUT;
+    uint64_t firstGroup = (lo + groupSize - 1) / groupSize;
+    uint64_t endGroup = hi / groupSize;
+    if (firstGroup >= endGroup) {
+        collectTop(levels - 1, lo, hi, want, best);
+        return;
+    }
+    collectTop(levels - 1, lo, static_cast<uint32_t>(firstGroup * groupSize), want, best);
+    const std::vector<uint32_t>& table = topLevels[levels - 1];
+    for (uint64_t g = firstGroup; g < endGroup; ++g) {
+        for (size_t slot = 0; slot < TOP_PER_GROUP; ++slot) {
+            uint32_t index = table[g * TOP_PER_GROUP + slot];
+            // lists are most popular first, so the rest of this one can't get in either
+            if (index == NO_NAME || (best.size() == want && !morePopular(index, best.front())))
+                break;
+            offer(index, want, best);
+        }
+    }
+    collectTop(levels - 1, static_cast<uint32_t>(endGroup * groupSize), hi, want, best);
+}
+
+void UsernameIndex::add(User* user) {
+    std::pair<std::string, User*> entry(fold(user->getUserName()), user);
+    pending.insert(std::upper_bound(pending.begin(), pending.end(), entry), std::move(entry));
+    if (pending.size() < PENDING_LIMIT)
+        return;
+    std::vector<User*> allUsers = users;
+    for (const std::pair<std::string, User*>& waiting : pending)
+        allUsers.push_back(waiting.second);
+    build(allUsers);
+}
+
+void UsernameIndex::clear() {
+    nameText.clear();
+    nameOffsets.assign(1, 0);
+    users.clear();
+    popularity.clear();
+    trieNodes.clear();
+    topLevels.clear();
+    pending.clear();
+}
+
+// A range of names sharing their first 'depth' bytes: one trie node.
+struct UsernameRange {
+    uint32_t lo;
+    uint32_t hi;
+    uint32_t distance;
+};
+
+// Walks the trie implied by the sorted names, carrying one edit-distance row per depth.
+class UsernameTrieWalk {
+private:
+    const std::string_view typed;
+    const uint32_t maxEdits;
+    const size_t width; // typed.size() + 1
+    std::vector<uint32_t> rows; // row d at [d * width, (d + 1) * width)
+    std::string path;           // the node's characters
+public:
+    std::vector<UsernameRange> hits;
+
+    UsernameTrieWalk(std::string_view _typed, uint32_t _maxEdits)
+        : typed(_typed), maxEdits(_maxEdits), width(_typed.size() + 1), rows(width) {
+        for (size_t j = 0; j < width; ++j)
+            rows[j] = static_cast<uint32_t>(j);
+    }
+
+    // Visits the children of the node [lo, hi) at 'depth', listed by trieNodes[node] if it has them.
+    template <typename NameAt>
+    void walk(const NameAt& nameAt, const std::vector<UsernameIndex::TrieNode>& nodes, size_t depth,
+              uint32_t lo, uint32_t hi, uint32_t node) {
+        if (rows.size() < (depth + 2) * width)
+            rows.resize((depth + 2) * width);
+        path.resize(depth + 1);
+        if (node != NO_TRIE_NODE) {
+            for (uint32_t child = nodes[node].firstChild; child < nodes[node].firstChild + nodes[node].childCount; ++child)
+                visit(nameAt, nodes, depth, nodes[child].c, nodes[child].lo, nodes[child].hi,
+                      nodes[child].childCount > 0 ? child : NO_TRIE_NODE);
+            return;
+        }
+        // names that end here sort first
+        while (lo < hi && nameAt(lo).size() == depth)
+            ++lo;
+        while (lo < hi) {
+            uint32_t end = usernameChildEnd(nameAt, depth, lo, hi);
+            visit(nameAt, nodes, depth, nameAt(lo)[depth], lo, end, NO_TRIE_NODE);
+            lo = end;
+        }
+    }
+
+    template <typename NameAt>
+    void visit(const NameAt& nameAt, const std::vector<UsernameIndex::TrieNode>& nodes, size_t depth, char c,
+               uint32_t lo, uint32_t hi, uint32_t node) {
+        path[depth] = c;
+        const uint32_t* previous = &rows[depth * width];
+        uint32_t* current = &rows[(depth + 1) * width];
+        current[0] = static_cast<uint32_t>(depth + 1);
+        uint32_t smallest = current[0];
+        for (size_t j = 1; j < width; ++j) {
+            uint32_t cost = std::min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + (typed[j - 1] != c)});
+            if (depth > 0 && j > 1 && typed[j - 2] == c && typed[j - 1] == path[depth - 1])
+                cost = std::min(cost, rows[(depth - 1) * width + j - 2] + 1);
+            current[j] = cost;
+            smallest = std::min(smallest, cost);
+        }
+        uint32_t distance = current[width - 1];
+        if (distance <= maxEdits)
+            hits.push_back({lo, hi, distance});
+        // deeper nodes are subsets; only worth visiting while they could match more closely
+        bool deeperCanImprove = distance <= maxEdits ? distance > 0 && smallest < distance : smallest <= maxEdits;
+        if (deeperCanImprove)
+            walk(nameAt, nodes, depth + 1, lo, hi, node);
+    }
+};
+
+// A user that matched, before the viewer's boosts are looked up.
+struct UsernameCandidate {
+    User* user;
+    uint32_t distance;
+    uint32_t popularity;
+};
+
+std::vector<UsernameMatch> UsernameIndex::complete(std::string_view typed, size_t limit, const User* viewer) const {
+    std::vector<UsernameMatch> ranked;
+    std::string folded = fold(typed.substr(0, MAX_TYPED));
+    limit = std::min(limit, TOP_PER_GROUP);
+    if (folded.empty() || limit == 0)
+        return ranked;
+    uint32_t maxEdits = maxEditsFor(folded.size());
+
+    // recent sign-ups and the viewer's friends are few enough to check one by one
+    std::vector<UsernameCandidate> candidates;
+    for (const std::pair<std::string, User*>& waiting : pending) {
+        uint32_t distance = prefixDistance(folded, waiting.first, maxEdits);
+        if (distance != UINT32_MAX)
+            candidates.push_back({waiting.second, distance, static_cast<uint32_t>(waiting.second->friendCount())});
+    }
+    if (viewer != nullptr) {
+        size_t scanned = 0;
+        for (User* friendUser : viewer->getFriends()) {
+            if (++scanned > MAX_FRIENDS_SCANNED)
+                break;
+            uint32_t distance = prefixDistance(folded, friendUser->getUserName(), maxEdits);
+            if (distance != UINT32_MAX)
+                candidates.push_back({friendUser, distance, static_cast<uint32_t>(friendUser->friendCount())});
+        }
+    }
+    auto byUserThenDistance = [](const UsernameCandidate& a, const UsernameCandidate& b) {
+        return a.user != b.user ? a.user < b.user : a.distance < b.distance;
+    };
+    auto sameUser = [](const UsernameCandidate& a, const UsernameCandidate& b) { return a.user == b.user; };
+    auto dedupe = [&]() {
+        std::sort(candidates.begin(), candidates.end(), byUserThenDistance);
+        candidates.erase(std::unique(candidates.begin(), candidates.end(), sameUser), candidates.end());
+    };
+    auto candidatesWithin = [&](uint32_t distance) {
+        return static_cast<size_t>(std::count_if(candidates.begin(), candidates.end(), [&](const UsernameCandidate& c) {
+            return c.distance <= distance && c.user != viewer;
+        }));
+    };
+
+    // Closer matches always rank first, so the trie is searched with one more edit at a time,
+    // and only while the closer ones don't fill the page.
+    std::vector<uint32_t> best;
+    for (uint32_t edits = 0; edits <= maxEdits && !users.empty(); ++edits) {
+        UsernameTrieWalk trie(folded, edits);
+        uint32_t root = trieNodes[0].childCount > 0 ? 0 : NO_TRIE_NODE;
+        trie.walk([this](uint32_t i) { return nameAt(i); }, trieNodes, 0, 0, static_cast<uint32_t>(users.size()), root);
+        // a node and its descendants can both match; only the outermost range is searched
+        std::sort(trie.hits.begin(), trie.hits.end(), [](const UsernameRange& a, const UsernameRange& b) {
+            return a.lo != b.lo ? a.lo < b.lo : a.hi > b.hi;
+        });
+        best.clear();
+        uint32_t covered = 0;
+        for (const UsernameRange& hit : trie.hits) {
+            if (hit.distance != edits || hit.hi <= covered)
+                continue;
+            collectTop(topLevels.size(), hit.lo, hit.hi, TOP_PER_GROUP, best);
+            covered = hit.hi;
+        }
+        for (uint32_t index : best)
+            candidates.push_back({users[index], edits, popularity[index]});
+        dedupe();
+        if (candidatesWithin(edits) >= limit)
+            break;
+    }
+    dedupe();
+
+    // nobody past the page's farthest distance can make it, so only the rest get their boosts
+    std::sort(candidates.begin(), candidates.end(),
+              [](const UsernameCandidate& a, const UsernameCandidate& b) { return a.distance < b.distance; });
+    uint32_t cutoff = UINT32_MAX;
+    size_t counted = 0;
+    for (const UsernameCandidate& candidate : candidates) {
+        if (candidate.user != viewer && ++counted == limit) {
+            cutoff = candidate.distance;
+            break;
+        }
+    }
+    std::vector<std::pair<UsernameMatch, uint32_t>> matches; // with popularity
+    for (const UsernameCandidate& candidate : candidates) {
+        if (candidate.distance > cutoff)
+            break;
+        if (candidate.user == viewer)
+            continue;
+        UsernameMatch match;
+        match.user = candidate.user;
+        match.distance = candidate.distance;
+        if (viewer != nullptr) {
+            match.isFriend = viewer->hasFriend(candidate.user);
+            match.mutualFriends = static_cast<uint32_t>(viewer->mutualFriendCount(candidate.user));
+        }
+        matches.emplace_back(match, candidate.popularity);
+    }
+    auto ranksHigher = [](const std::pair<UsernameMatch, uint32_t>& a, const std::pair<UsernameMatch, uint32_t>& b) {
+        const UsernameMatch& x = a.first;
+        const UsernameMatch& y = b.first;
+        if (x.distance != y.distance)
+            return x.distance < y.distance;
+        if (x.isFriend != y.isFriend)
+            return x.isFriend;
+        if (x.mutualFriends != y.mutualFriends)
+            return x.mutualFriends > y.mutualFriends;
+        if (a.second != b.second)
+            return a.second > b.second;
+        return x.user->getUserName() < y.user->getUserName();
+    };
+    size_t kept = std::min(limit, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + static_cast<std::ptrdiff_t>(kept), matches.end(), ranksHigher);
+    for (size_t i = 0; i < kept; ++i)
+        ranked.push_back(matches[i].first);
+    return ranked;
+}
@@ -1,6 +1,108 @@
 #include "Fakebook.h"
-int main() {
-    FakeBook fakebookApp;
-    fakebookApp.runFakeBook();
+#include "BatchRunner.h"
+#include "DummyDataGenerator.h"
+#include "SessionServer.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+int main(int argc, char* argv[]) {
+    FakeBookOptions options;
+    std::string batchScript; // --batch: replay this script instead of showing the menu
+    bool serve = false;      // --serve: run multiplexed sessions from stdin instead of the menu
+    unsigned sessionThreads = std::max(1u, std::thread::hardware_concurrency());
+    DummyDataOptions generate; // --generate: write a DataStorage of this many users and exit
+    bool generateOnly = false;
+    std::string recommendFile; // --recommend: write every user's "people you may know" here and exit
+    size_t recommendLimit = 10;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            options.ingestThreads = generate.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--no-snapshot") == 0)
+            options.useSnapshot = false;
+        else if (std::strcmp(argv[i], "--feed-capacity") == 0 && i + 1 < argc)
+            options.feedCapacity = static_cast<size_t>(std::atoll(argv[++i]));
+        else if (std::strcmp(argv[i], "--feed-page-size") == 0 && i + 1 < argc)
+            options.feedPageSize = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        else if (std::strcmp(argv[i], "--celebrity-threshold") == 0 && i + 1 < argc)
+            options.celebrityThreshold = static_cast<size_t>(std::atoll(argv[++i]));
+        else if (std::strcmp(argv[i], "--worker-id") == 0 && i + 1 < argc)
+            options.workerId = static_cast<uint32_t>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--hash-threads") == 0 && i + 1 < argc)
+            options.hashThreads = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        else if (std::strcmp(argv[i], "--max-queued-logins") == 0 && i + 1 < argc)
+            options.maxQueuedLogins = static_cast<size_t>(std::atoll(argv[++i]));
+        else if (std::strcmp(argv[i], "--password-iterations") == 0 && i + 1 < argc)
+            options.passwordIterations = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        else if (std::strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+            batchScript = argv[++i];
+        else if (std::strcmp(argv[i], "--serve") == 0)
+            serve = true;
+        else if (std::strcmp(argv[i], "--session-threads") == 0 && i + 1 < argc)
+            sessionThreads = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        else if (std::strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+            options.metricsFile = argv[++i];
+        else if (std::strcmp(argv[i], "--metrics-interval") == 0 && i + 1 < argc)
+            options.metricsIntervalSeconds = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        else if (std::strcmp(argv[i], "--max-separation") == 0 && i + 1 < argc)
+            options.maxSeparation = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        else if (std::strcmp(argv[i], "--recommend") == 0 && i + 1 < argc)
+            recommendFile = argv[++i];
+        else if (std::strcmp(argv[i], "--recommend-limit") == 0 && i + 1 < argc)
+            recommendLimit = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        else if (std::strcmp(argv[i], "--generate") == 0 && i + 1 < argc) {
+            generate.userCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            generateOnly = true;
+        } else if (std::strcmp(argv[i], "--posts-per-user") == 0 && i + 1 < argc)
+            generate.maxPostsPerUser = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--average-degree") == 0 && i + 1 < argc)
+            generate.averageDegree = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            generate.seed = std::strtoull(argv[++i], nullptr, 10);
+    }
+    if (generateOnly) {
+        auto start = std::chrono::steady_clock::now();
+        DummyDataGenerator generator(generate);
+        generator.populateUsers();
+        generator.populateFriendsAndRequests();
+        generator.populatePosts();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Dummy data generation complete in " << seconds << " s." << std::endl;
+        return 0;
+    }
+    FakeBook fakebookApp(options);
+    if (!recommendFile.empty()) {
+        auto start = std::chrono::steady_clock::now();
+        if (!fakebookApp.saveRecommendations(recommendFile, recommendLimit))
+            return 1;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Recommendations written to " << recommendFile << " in " << seconds << " s." << std::endl;
+        return 0;
+    }
+    if (serve) {
+        auto start = std::chrono::steady_clock::now();
+        {
+            SessionServer server(fakebookApp, sessionThreads);
+            server.serve(std::cin, std::cout);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cerr << server.commandCount() << " commands from " << server.sessionCount() << " sessions on "
+                      << sessionThreads << " threads in " << seconds << " s" << std::endl;
+        }
+        fakebookApp.shutdown();
+        return 0;
+    }
+    if (batchScript.empty()) {
+        fakebookApp.runFakeBook();
+        return 0;
+    }
+    BatchRunner runner(fakebookApp);
+    if (!runner.run(batchScript))
+        return 1;
+    runner.printReport(std::cout);
+    fakebookApp.shutdown();
     return 0;
-}
\ No newline at end of file
+}